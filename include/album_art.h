@@ -0,0 +1,22 @@
+#ifndef ALBUM_ART_H
+#define ALBUM_ART_H
+
+#include <Arduino.h>
+#include "file_manager.h"
+
+// Cover art is pulled out of the ID3 APIC frame once, decoded and scaled to
+// a square thumbnail in the background, and cached on SD as raw RGB565 in the
+// panel's byte order, so showing it later is one read plus a blit.
+#define ALBUM_ART_DIR INDEX_DIR "/art"
+constexpr int ALBUM_ART_SIZE = 42;
+constexpr uint32_t ALBUM_ART_MAGIC = 0x31545241; // "ART1"
+
+void initAlbumArt();
+// Returns the request's serial; only the cover for the latest request is
+// ever handed out.
+uint32_t requestAlbumArt(const String &path);
+// Copies ALBUM_ART_SIZE^2 pixels into `pixels` when the cover changed since
+// `generation`, which is then updated; true while a cover is available.
+bool albumArtFor(uint32_t request, uint16_t *pixels, uint32_t &generation);
+
+#endif
@@ -19,9 +19,7 @@ extern Audio audio;
 extern int8_t volume;
 extern bool isPlaying;
 extern bool isStoped;
-extern uint8_t hpDetectPin;
 extern uint8_t ampEnablePin;
-extern bool lastHPState;
 extern bool codec_initialized;
 
 void handlePlayback(bool playCommand, bool stopCommand, bool nextTrack = false, bool prevTrack = false);
@@ -29,7 +27,8 @@ void resetTimer();
 
 bool initES8311Codec();
 void changeVolume(int8_t v);
-void playTestTone(uint32_t freq_hz, uint32_t duration_ms, uint32_t sample_rate = 44100, uint16_t amplitude = 12000);
-void updateHeadphoneDetection();
+// Reports headphone amp switching from a task context (the sensor callback
+// only flips the pin).
+void logAmpSwitch();
 
 #endif
\ No newline at end of file
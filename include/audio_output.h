@@ -0,0 +1,59 @@
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include <Arduino.h>
+#include "driver/i2s.h"
+
+constexpr i2s_port_t AUDIO_OUTPUT_PORT = I2S_NUM_1;
+constexpr uint32_t AUDIO_OUTPUT_DEFAULT_RATE = 44100;
+constexpr int AUDIO_OUTPUT_DMA_LEN = 256;
+constexpr int AUDIO_OUTPUT_DMA_MIN_COUNT = 3;
+constexpr int AUDIO_OUTPUT_DMA_MAX_COUNT = 16;
+constexpr int AUDIO_OUTPUT_DMA_COUNT = 6;
+
+// Adaptive policy: grow by one step as soon as the DMA runs dry, shrink back
+// one step after a quiet period, but only while the output is idle.
+constexpr int AUDIO_OUTPUT_DMA_GROW_STEP = 4;
+constexpr int AUDIO_OUTPUT_DMA_SHRINK_STEP = 2;
+constexpr uint32_t AUDIO_OUTPUT_SHRINK_AFTER_MS = 60000;
+
+// Pause/resume ramp; frames decoded past the end of a fade-out are held and
+// replayed (faded in) on resume so no audio is skipped. The audio task stops
+// pulling from the decoder once the fade is done, so the hold only has to
+// cover the rest of one decoder call; audioOutputReserveHold() grows it for
+// formats with bigger blocks. HOLD_FRAMES is the floor (two MP3 frames).
+constexpr uint32_t AUDIO_OUTPUT_FADE_MS = 8;
+constexpr size_t AUDIO_OUTPUT_HOLD_FRAMES = 2304;
+
+struct AudioOutputStats {
+    uint16_t dmaCount;
+    uint16_t dmaLen;
+    uint32_t sampleRate;
+    uint32_t underruns;
+    uint32_t reconfigs;
+    uint32_t latencyUs;   // audio queued in DMA right now
+    uint32_t capacityUs;  // worst-case latency for the current geometry
+    uint32_t holdRejected; // frames refused while paused with the hold full
+};
+
+bool initAudioOutput();
+bool audioOutputConfigure(int dmaCount, int dmaLen);
+void audioOutputSetAdaptive(bool enabled);
+void audioOutputIdle();
+void audioOutputReset();
+void audioOutputPause(uint32_t originUs);
+void audioOutputForcePause();
+bool audioOutputPaused();
+void audioOutputResume();
+bool audioOutputReserveHold(size_t frames);
+// Returns the frames accepted; short only if a pause hold overflows.
+size_t audioOutputWrite(const int16_t *frames, size_t frameCount);
+uint32_t audioOutputFramesWritten();
+// Frames accepted but not yet played: the DMA queue plus any pause hold.
+uint32_t audioOutputPendingFrames();
+uint32_t audioOutputBlockedUs();
+bool audioOutputSetSampleRate(uint32_t sampleRate);
+uint32_t audioOutputSampleRate();
+AudioOutputStats getAudioOutputStats();
+
+#endif
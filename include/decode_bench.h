@@ -0,0 +1,32 @@
+#ifndef DECODE_BENCH_H
+#define DECODE_BENCH_H
+
+#include <Arduino.h>
+
+// Decodes every audio file in a folder as fast as the decoder allows,
+// through the same Audio path Task_Audio plays from, with the output
+// discarded. Runs on Task_Audio; trigger it with sendDecodeBenchmark().
+#define DECODE_BENCH_DIR "/bench"
+constexpr uint32_t DECODE_BENCH_SLICE_US = 200000;
+constexpr uint32_t DECODE_BENCH_TIMEOUT_MS = 300000;
+
+struct DecodeBenchResult {
+    uint32_t sampleRate;
+    uint32_t bitRate;
+    uint8_t channels;
+    uint32_t audioMs;
+    uint32_t wallMs;
+    uint32_t connectUs;
+    uint32_t rtfX1000;
+    uint32_t frames;
+    uint32_t avgFrameUs;
+    uint32_t peakFrameUs;
+    uint32_t heapPeak;
+};
+
+bool decodeBenchActive();
+void decodeBenchOnFrame(uint16_t validSamples);
+uint32_t runDecodeBenchmark(const String &folder);
+uint32_t decodeBenchRuns();
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef DECODE_COST_H
+#define DECODE_COST_H
+
+#include <Arduino.h>
+#include "track_probe.h"
+
+// What decoding a stream costs on core 1: share of the core (permille, i.e.
+// real-time factor x1000) and decoder heap. Costs measured by the decode
+// benchmark are kept in NVS and win; other formats are scaled from the
+// closest measurement of the same codec, or from a built-in model.
+constexpr uint16_t DECODE_CPU_BUDGET_PERMILLE = 600;
+constexpr uint16_t DECODE_CPU_WARN_PERMILLE = 400;
+constexpr uint32_t DECODE_HEAP_BUDGET = 48 * 1024;
+constexpr uint8_t DECODE_COST_SLOTS = 16;
+
+enum DecodeVerdict : uint8_t {
+    DECODE_OK,
+    DECODE_WARN,
+    DECODE_REFUSE
+};
+
+struct DecodeCost {
+    uint16_t cpuPermille;
+    uint32_t heapBytes;
+    bool measured;
+};
+
+void initDecodeCosts();
+DecodeCost estimateDecodeCost(const TrackFormat &fmt);
+DecodeVerdict checkDecodeBudget(const TrackFormat &fmt, DecodeCost &cost);
+void recordDecodeCost(const TrackFormat &fmt, uint32_t rtfX1000, uint32_t heapBytes);
+void printDecodeCosts();
+
+#endif
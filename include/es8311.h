@@ -0,0 +1,44 @@
+#ifndef ES8311_H
+#define ES8311_H
+
+#include <Arduino.h>
+
+// ES8311 register map (subset used by the player)
+constexpr uint8_t ES8311_REG_RESET = 0x00;
+constexpr uint8_t ES8311_REG_CLK_MANAGER1 = 0x01;
+constexpr uint8_t ES8311_REG_CLK_MANAGER2 = 0x02;
+constexpr uint8_t ES8311_REG_SYSTEM_0D = 0x0D;
+constexpr uint8_t ES8311_REG_SYSTEM_12 = 0x12;
+constexpr uint8_t ES8311_REG_SYSTEM_13 = 0x13;
+constexpr uint8_t ES8311_REG_DAC_31 = 0x31;
+constexpr uint8_t ES8311_REG_DAC_VOLUME = 0x32;
+constexpr uint8_t ES8311_REG_DAC_37 = 0x37;
+constexpr uint8_t ES8311_REG_CHIP_ID1 = 0xFD;
+constexpr uint8_t ES8311_REG_CHIP_ID2 = 0xFE;
+
+constexpr uint8_t ES8311_REG_COUNT = 0x45;
+
+enum Es8311Power : uint8_t {
+    ES8311_POWER_ON,
+    ES8311_POWER_STANDBY
+};
+
+struct Es8311Stats {
+    uint32_t transactions;
+    uint32_t bytesWritten;
+    uint32_t skippedWrites;
+    uint32_t verifyFailures;
+    uint32_t lastConfigUs;
+};
+
+bool es8311Begin();
+bool es8311WriteBlock(uint8_t reg, const uint8_t *values, size_t len);
+bool es8311Update(uint8_t reg, uint8_t value);
+bool es8311Verify(uint8_t reg, size_t len);
+bool es8311SetSampleRate(uint32_t sampleRate, uint8_t bitsPerFrame);
+bool es8311SetPower(Es8311Power state);
+bool es8311SetMute(bool mute);
+bool es8311SetDacVolume(uint8_t value);
+Es8311Stats es8311GetStats();
+
+#endif
@@ -4,31 +4,71 @@
 #include <Arduino.h>
 #include <SD.h>
 #include <SPI.h>
+#include "track_probe.h"
 
 #define SD_SCK 40
 #define SD_MISO 39
 #define SD_MOSI 14
 #define SD_CS 12
 
-#define MAX_FILES 100
+#define INDEX_DIR "/.mp3player"
+#define TRACK_CACHE_SIZE 32
+#define TRACK_LOOKAHEAD 8
+#define MAX_FOLDERS 20
 
-extern String audioFiles[MAX_FILES];
-extern uint8_t fileCount;
-extern uint8_t currentFileIndex;
+// Folder listings are cached (LRU) so navigating back and forth doesn't
+// rescan the card; entries are rechecked against the directory mtime.
+// The byte ceiling covers the slots themselves plus the heap their
+// strings hold.
+#define DIR_CACHE_SLOTS 8
+#define DIR_CACHE_MAX_BYTES 6144
+#define DIR_CACHE_REVALIDATE_MS 10000
+
+struct DirCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t bytes;
+    uint8_t entries;
+};
+
+extern uint32_t fileCount;
+extern uint32_t currentFileIndex;
 extern String currentFolder;
 
 extern String availableFolders[];
 extern uint8_t folderCount;
+extern uint32_t browseAudioCount;
 
 extern bool isScanning;
 extern bool isScanningFiles;
-extern uint8_t scanProgress;
-extern uint8_t scanTotal;
+extern uint32_t scanProgress;
+extern uint32_t scanTotal;
 
 extern SemaphoreHandle_t sdMutex;
 
 bool initSDCard();
-void scanDirectory(const String& folder);
-String getFileName(uint8_t index);
+void openDirectory(const String& path);
+bool loadPlaylist(const String& folder);
+// Indexes the folder if needed but leaves the active playlist alone.
+bool getFolderTrackCount(const String& folder, uint32_t& count);
+DirCacheStats getDirCacheStats();
+String getPlaylistFolder();
+uint32_t getPlaylistMtime();
+bool getFolderMtime(const String& folder, uint32_t& mtime);
+int32_t findTrack(const String& name);
+void prefetchTracks(uint32_t first, uint32_t count);
+String getTrackPath(uint32_t index);
+String getFileName(uint32_t index);
+bool isAudioFile(const String& name);
+
+// Every entry is probed once at scan time and the result kept in the index;
+// navigation uses these to step over files the decoder would reject.
+// nextPlayable() wraps around and returns -1 when nothing in the folder plays.
+uint32_t getPlayableCount();
+bool isTrackPlayable(uint32_t index);
+bool getTrackFormat(uint32_t index, TrackFormat& fmt);
+int32_t nextPlayable(uint32_t index, int8_t direction);
+int32_t randomPlayable();
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,30 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <Arduino.h>
+
+enum RedrawReason : uint32_t {
+    REDRAW_INPUT = 1UL << 0,
+    REDRAW_STATE = 1UL << 1,
+    REDRAW_ANIMATION = 1UL << 2
+};
+
+struct FrameStats {
+    uint16_t fpsX10;
+    uint32_t avgFrameUs;
+    uint32_t maxFrameUs;
+    uint32_t totalFrames;
+};
+
+void initFrameScheduler(TaskHandle_t uiTask);
+void requestRedraw(uint32_t reason = REDRAW_STATE);
+void requestRedrawFromISR(uint32_t reason);
+void scheduleRedrawIn(uint32_t ms);
+void cancelScheduledRedraw();
+uint32_t waitForFrameEvent(uint32_t maxWaitMs);
+
+void beginFrame();
+void endFrame();
+FrameStats getFrameStats();
+
+#endif
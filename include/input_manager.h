@@ -0,0 +1,23 @@
+#ifndef INPUT_MANAGER_H
+#define INPUT_MANAGER_H
+
+#include <Arduino.h>
+
+constexpr int CARDPUTER_KB_INT_PIN = 11;
+constexpr uint32_t INPUT_FALLBACK_POLL_MS = 500;
+constexpr char INPUT_KEY_DIAGNOSTICS = 0x04; // opt+d
+
+struct InputEvent {
+    char key;
+    uint16_t repeat;
+    uint32_t timestampUs;
+};
+
+void initInput();
+bool inputInterruptActive();
+bool pollInput();
+bool injectInput(char key, uint16_t repeat = 0);
+bool nextInputEvent(InputEvent &evt);
+uint32_t msUntilInputDeadline();
+
+#endif
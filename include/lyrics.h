@@ -0,0 +1,17 @@
+#ifndef LYRICS_H
+#define LYRICS_H
+
+#include <Arduino.h>
+
+// A track's .lrc file is indexed once into a sorted (time, file offset)
+// table; line text stays on SD and only the current line is held in RAM.
+constexpr size_t LYRICS_MAX_LINES = 512;
+constexpr size_t LYRICS_MAX_LINE_LEN = 255;
+
+bool loadLyrics(const String &trackPath);
+void clearLyrics();
+bool lyricsLoaded();
+int32_t lyricLineAt(uint32_t positionMs);
+const String &lyricText(int32_t line);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef PLAYBACK_STATE_H
+#define PLAYBACK_STATE_H
+
+#include <Arduino.h>
+
+// Last-played state lives in NVS as a single blob, so a reset mid-write
+// leaves either the old or the new record, never a mix of the two.
+constexpr uint32_t PLAYBACK_SAVE_INTERVAL_MS = 15000;
+constexpr size_t PLAYBACK_FOLDER_MAX = 128;
+constexpr size_t PLAYBACK_TRACK_MAX = 96;
+
+struct PlaybackState {
+    String folder;
+    String track;
+    uint32_t index;
+    uint32_t positionMs;
+    uint32_t folderMtime;
+};
+
+void initPlaybackState();
+bool loadPlaybackState(PlaybackState &state);
+void updatePlaybackState(const PlaybackState &state, bool force);
+bool saveBookmark(const String &path, uint32_t positionMs);
+bool loadBookmark(const String &path, uint32_t &positionMs);
+
+#endif
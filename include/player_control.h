@@ -0,0 +1,69 @@
+#ifndef PLAYER_CONTROL_H
+#define PLAYER_CONTROL_H
+
+#include <Arduino.h>
+#include "spsc_queue.h"
+
+constexpr size_t PLAYER_PATH_MAX = 256;
+
+enum PlayerCommandType : uint8_t {
+    CMD_PLAY,
+    CMD_PAUSE,
+    CMD_RESUME,
+    CMD_STOP,
+    CMD_SEEK,
+    CMD_VOLUME,
+    CMD_BENCHMARK,
+    CMD_DIAGNOSTICS,
+    CMD_SPEED,
+    CMD_SD_BENCHMARK
+};
+
+enum PlayerEventType : uint8_t {
+    EVT_TRACK_STARTED,
+    EVT_TRACK_FAILED,
+    EVT_TRACK_ENDED,
+    EVT_POSITION,
+    EVT_PAUSED,
+    EVT_RESUMED,
+    EVT_STOPPED
+};
+
+// Every CMD_PLAY starts a new generation; events carry the generation of
+// the play they belong to, so a late event from an earlier play of the same
+// index (replay, n then p, another folder) can be told apart.
+struct PlayerCommand {
+    PlayerCommandType type;
+    uint32_t trackIndex;
+    uint32_t generation;
+    int32_t value;
+    uint32_t originUs;
+    uint32_t issuedUs;
+    char path[PLAYER_PATH_MAX];
+};
+
+struct PlayerEvent {
+    PlayerEventType type;
+    uint32_t trackIndex;
+    uint32_t value;
+    uint32_t generation;
+};
+
+// Task_TFT owns the track list and navigation: it is the only producer of
+// commands and the only consumer of events. Task_Audio owns the decoder and
+// is the only consumer of commands and the only producer of events.
+extern SpscQueue<PlayerCommand, 8> playerCommands;
+extern SpscQueue<PlayerEvent, 32> playerEvents;
+
+void initPlayerControl(TaskHandle_t audioTask);
+void setCommandOrigin(uint32_t timestampUs);
+bool sendPlayerCommand(PlayerCommandType type, int32_t value = 0);
+bool sendPlayTrack(uint32_t index, const String& path, uint32_t startMs = 0);
+bool sendDecodeBenchmark(const String& folder);
+bool postPlayerEvent(PlayerEventType type, uint32_t trackIndex, uint32_t value = 0);
+// UI side: generation of the most recent play sent.
+uint32_t currentPlayGeneration();
+// Audio side: events posted from now on belong to this play.
+void beginPlayGeneration(uint32_t generation);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <Arduino.h>
+
+struct PowerStats {
+    uint16_t cpuMhz;
+    uint8_t busyPct;
+};
+
+// After setup() only Task_TFT calls these (profiler windows, track starts).
+void initPowerGovernor();
+void powerGovernorBoost();
+void powerGovernorUpdate();
+PowerStats getPowerStats();
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+enum ProfTask {
+    PROF_TASK_UI,
+    PROF_TASK_AUDIO,
+    PROF_TASK_COUNT
+};
+
+enum ProfLatency {
+    PROF_LAT_KEY_TO_AUDIO,
+    PROF_LAT_KEY_TO_PIXELS,
+    PROF_LAT_KEY_TO_SILENCE,
+    PROF_LAT_SKIP_TO_AUDIO,
+    PROF_LAT_COUNT
+};
+
+struct LatencyStats {
+    uint32_t lastUs;
+    uint32_t avgUs;
+    uint32_t maxUs;
+    uint32_t samples;
+};
+
+struct ProfilerSnapshot {
+    uint32_t timestampMs;
+    uint8_t cpuPct[PROF_TASK_COUNT];
+    uint32_t stackFree[PROF_TASK_COUNT];
+    uint16_t wakeups[PROF_TASK_COUNT];
+    uint16_t fpsX10;
+    uint32_t renderUs;
+    uint32_t pushUs;
+    uint32_t audioPeriodAvgUs;
+    uint32_t audioPeriodMaxUs;
+    uint32_t underruns;
+    uint32_t heapFree;
+    uint32_t heapLargest;
+    LatencyStats latency[PROF_LAT_COUNT];
+};
+
+extern bool profilerHudVisible;
+extern bool profilerStreamEnabled;
+
+void profilerRegisterTask(ProfTask task, TaskHandle_t handle);
+void profilerAddBusy(ProfTask task, uint32_t us);
+void profilerWakeup(ProfTask task);
+void profilerAudioTick();
+void profilerUnderrun();
+void profilerFramePushed(uint32_t us);
+void profilerLatency(ProfLatency kind, uint32_t us);
+bool profilerUpdate();
+const ProfilerSnapshot& getProfilerSnapshot();
+
+#endif
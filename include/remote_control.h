@@ -0,0 +1,52 @@
+#ifndef REMOTE_CONTROL_H
+#define REMOTE_CONTROL_H
+
+#include <Arduino.h>
+
+// Framed remote control on the USB serial port, sharing it with the text log
+// and console lines. A frame is
+//   STX | len | seq | type | payload[len] | crc16
+// with the CRC (CCITT-FALSE, little-endian) taken over len..payload. Log text
+// never contains STX, so hosts can pick frames out of the log stream.
+// Replies carry the request's seq and type | REMOTE_REPLY. See tools/remote.py.
+constexpr uint8_t REMOTE_STX = 0x02;
+constexpr uint8_t REMOTE_MAX_PAYLOAD = 240;
+constexpr uint32_t REMOTE_FRAME_TIMEOUT_MS = 200;
+// While a host has sent frames recently, Task_TFT polls the port at this
+// interval instead of waiting out its input poll.
+constexpr uint32_t REMOTE_POLL_MS = 5;
+constexpr uint32_t REMOTE_ACTIVE_MS = 30000;
+
+enum RemoteMessage : uint8_t {
+    REMOTE_PING = 0x01,
+    REMOTE_KEY = 0x02,          // key, repeat:u16
+    REMOTE_ACTION = 0x03,       // action, value:i32, path
+    REMOTE_GET_STATE = 0x04,
+    REMOTE_GET_COUNTERS = 0x05,
+    REMOTE_REPLY = 0x80,
+    REMOTE_ERROR = 0xFF         // status
+};
+
+enum RemoteAction : uint8_t {
+    REMOTE_ACT_PLAY = 1,        // value: track index in the current playlist
+    REMOTE_ACT_NEXT,
+    REMOTE_ACT_PREV,
+    REMOTE_ACT_TOGGLE_PAUSE,
+    REMOTE_ACT_STOP,
+    REMOTE_ACT_SEEK,            // value: position in ms
+    REMOTE_ACT_VOLUME,          // value: 0..64
+    REMOTE_ACT_OPEN_FOLDER,     // path: folder to play, value: start track
+    REMOTE_ACT_SCAN             // path: folder to list, playback untouched
+};
+
+enum RemoteStatus : uint8_t {
+    REMOTE_OK = 0,
+    REMOTE_BAD_FRAME,
+    REMOTE_UNKNOWN,
+    REMOTE_REJECTED
+};
+
+void pollRemote();
+uint32_t remotePollMs();
+
+#endif
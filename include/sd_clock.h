@@ -0,0 +1,30 @@
+#ifndef SD_CLOCK_H
+#define SD_CLOCK_H
+
+#include <Arduino.h>
+
+// The SPI clock is stepped up at mount until reads stop verifying, and the
+// fastest clean step is remembered per card so later boots mount at it
+// directly (after one verification pass).
+constexpr uint32_t SD_FREQ_SAFE = 4000000;
+constexpr uint32_t SD_FREQ_STEPS[] = {10000000, 16000000, 20000000, 26666667, 40000000};
+constexpr uint8_t SD_PROBE_SECTORS = 32;
+constexpr uint8_t SD_PROBE_PASSES = 2;
+constexpr uint32_t SD_PROBE_FILE_BYTES = 64 * 1024;
+constexpr uint32_t SD_BENCH_FILE_BYTES = 1024 * 1024;
+constexpr uint32_t SD_BENCH_MIN_BLOCK = 512;
+constexpr uint32_t SD_BENCH_MAX_BLOCK = 32 * 1024;
+constexpr uint16_t SD_BENCH_RANDOM_READS = 128;
+
+struct SdBenchResult {
+    uint32_t blockSize;
+    uint32_t seqKBps;
+    uint32_t randKBps;
+    uint32_t randAvgUs;
+};
+
+uint32_t sdMountTuned(uint8_t csPin);
+uint32_t sdClockHz();
+uint8_t sdBenchmark(SdBenchResult *results, uint8_t maxResults);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef SENSOR_SERVICE_H
+#define SENSOR_SERVICE_H
+
+#include <Arduino.h>
+
+enum SensorId : uint8_t {
+    SENSOR_HEADPHONES,
+    SENSOR_BATTERY
+};
+
+// Callbacks run in the timer daemon task: keep them short and don't log.
+typedef void (*SensorCallback)(SensorId id, int32_t value);
+
+void initSensors();
+bool sensorSubscribe(SensorCallback cb);
+bool headphonesInserted();
+uint8_t batteryLevel();
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SIGNAL_GEN_H
+#define SIGNAL_GEN_H
+
+#include <Arduino.h>
+
+// Test signals for the diagnostics mode and the startup tone. Everything is
+// rendered in fixed point, in blocks, into interleaved 16-bit stereo that
+// goes through audioOutputWrite() like decoded music.
+enum SignalType : uint8_t {
+    SIG_SINE,
+    SIG_SWEEP,
+    SIG_WHITE,
+    SIG_PINK,
+    SIG_CLICKS,
+    SIG_COUNT
+};
+
+constexpr uint32_t SIG_SINE_HZ = 1000;
+constexpr uint32_t SIG_SWEEP_FROM_HZ = 20;
+constexpr uint32_t SIG_SWEEP_TO_HZ = 20000;
+constexpr uint32_t SIG_SWEEP_MS = 10000;
+constexpr uint32_t SIG_CLICK_PERIOD_MS = 500;
+constexpr uint32_t SIG_CLICK_FRAMES = 16;
+constexpr int16_t SIG_LEVEL = 4096; // -18 dBFS
+constexpr int SIG_PINK_ROWS = 12;
+constexpr size_t SIG_SWEEP_STEP = 32; // frames per sweep increment
+
+struct SignalGen {
+    SignalType type;
+    int16_t level;
+    uint32_t sampleRate;
+    uint32_t phase;
+    uint32_t phaseInc;
+    uint32_t sweepStartInc;
+    uint32_t sweepEndInc;
+    uint32_t sweepRatioQ30;
+    uint32_t noise;
+    uint32_t pinkCounter;
+    int32_t pinkRows[SIG_PINK_ROWS];
+    int32_t pinkSum;
+    uint32_t clickPeriod;
+    uint32_t clickPos;
+    uint32_t clicks;
+};
+
+const char *signalName(SignalType type);
+void signalStart(SignalGen &gen, SignalType type, uint32_t sampleRate, uint32_t freqHz = SIG_SINE_HZ,
+                 int16_t level = SIG_LEVEL);
+
+// Fills frames of interleaved stereo; returns the frame offset of a click
+// onset inside this block, or -1 if there was none.
+int32_t signalRender(SignalGen &gen, int16_t *out, size_t frames);
+
+// Blocking sine through the output; used as the startup chime.
+void signalPlayTone(uint32_t freqHz, uint32_t durationMs, int16_t level = SIG_LEVEL);
+
+// Cycles per sample for each signal type, printed as $SIG lines.
+void signalBenchmark(uint32_t frames);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef TIME_STRETCH_H
+#define TIME_STRETCH_H
+
+#include <Arduino.h>
+
+// WSOLA time-stretch between the decoder and the output: the stream is cut
+// into overlapping sequences, and each one starts where the input best
+// lines up with the tail of the previous one (normalised cross-correlation
+// over a small search window), so speed changes without changing pitch.
+// Fixed point throughout; at 100% it is a straight pass-through.
+constexpr uint16_t STRETCH_SPEED_MIN = 75;
+constexpr uint16_t STRETCH_SPEED_MAX = 200;
+constexpr uint16_t STRETCH_SPEED_STEP = 25;
+
+constexpr size_t STRETCH_SEQUENCE_FRAMES = 1024;
+constexpr size_t STRETCH_OVERLAP_FRAMES = 256;
+constexpr size_t STRETCH_SEEK_FRAMES = 512;
+constexpr size_t STRETCH_SEEK_COARSE_STEP = 4;
+constexpr size_t STRETCH_BUFFER_FRAMES = 2048;
+constexpr size_t STRETCH_CARRY_FRAMES = 2048;
+
+typedef size_t (*StretchSink)(const int16_t *frames, size_t frameCount);
+
+void timeStretchSetSpeed(uint16_t percent, StretchSink sink);
+uint16_t timeStretchSpeed();
+void timeStretchReset();
+void timeStretchProcess(const int16_t *frames, size_t frameCount, StretchSink sink);
+void timeStretchFlush(StretchSink sink);
+// Output lost because the sink refused more than the carry buffer holds.
+uint32_t timeStretchDroppedFrames();
+
+// Stretches generated audio at each speed step with the output discarded;
+// prints the real-time factor per speed ($TSR lines).
+void timeStretchBenchmark(uint32_t seconds);
+
+#endif
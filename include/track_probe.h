@@ -0,0 +1,37 @@
+#ifndef TRACK_PROBE_H
+#define TRACK_PROBE_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+enum TrackCodec : uint8_t {
+    CODEC_MP3,
+    CODEC_WAV,
+    CODEC_FLAC
+};
+
+struct TrackFormat {
+    uint32_t sampleRate;
+    uint32_t durationMs;
+    uint32_t blockFrames; // largest unit the decoder works on
+    uint8_t bitsPerSample;
+    uint8_t channels;
+    TrackCodec codec;
+};
+
+// Reads just enough of the file header to learn the stream format, so the
+// output can be reclocked before the decoder produces its first frame.
+bool probeTrackFormat(const char *path, TrackFormat &fmt);
+
+// Same check on a file that is already open, for callers holding sdMutex.
+// Fails for anything the decoder couldn't play: no RIFF/fmt/data chunks,
+// unsupported PCM, no MPEG layer III sync confirmed by a second frame, or
+// no usable FLAC STREAMINFO.
+bool probeTrackFile(File &f, const String &name, TrackFormat &fmt);
+
+// File offset to resume a FLAC stream near positionMs, interpolated between
+// the SEEKTABLE points around it (the decoder resyncs on the next frame
+// header). False if the file has no seek table.
+bool probeFlacSeek(const char *path, uint32_t positionMs, uint32_t &fileOffset);
+
+#endif
@@ -14,20 +14,38 @@ extern M5Canvas sprite1;
 extern M5Canvas sprite2;
 extern M5Canvas overlaySprite;
 
-extern bool nextTrackRequest;
-
 extern uint8_t sliderPos;
 extern int16_t textPos;
-extern uint8_t graphSpeed;
-extern uint8_t g[14];
 extern unsigned short grays[18];
 extern unsigned short gray;
 extern unsigned short light;
-extern unsigned long trackStartMillis;
 extern unsigned long playbackTime;
+extern bool isScreenDimmed;
+
+struct PlayerSnapshot {
+    UIState uiState;
+    bool playing;
+    bool stopped;
+    bool screenDimmed;
+    uint32_t fileCount;
+    uint32_t trackIndex;
+    uint32_t positionMs;
+    uint32_t durationMs;
+    int8_t volume;
+    uint8_t brightness;
+    String folder;
+    String track;
+};
 
 void initUI();
-void draw();
-void handleKeyPress(char key);
+bool draw();
+uint32_t getFrameIntervalMs();
+uint32_t getInputPollMs();
+void checkScreenTimeout();
+void handleKeyPress(char key, uint16_t repeat = 0);
+bool processPlayerEvents();
+bool resumeLastSession();
+void getPlayerSnapshot(PlayerSnapshot &snap);
+bool handleRemoteAction(uint8_t action, int32_t value, const String &path);
 
 #endif
\ No newline at end of file
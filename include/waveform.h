@@ -0,0 +1,29 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <Arduino.h>
+#include "file_manager.h"
+
+// A per-track peak envelope (min/max of the mono mix per bin) cached on SD
+// next to the album art, so the progress bar is one read plus a blit. WAV
+// files are scanned in the background; compressed tracks are captured from
+// the decoder's own output the first time they play start to finish.
+#define WAVEFORM_DIR INDEX_DIR "/wave"
+constexpr size_t WAVEFORM_BINS = 86;
+constexpr uint32_t WAVEFORM_MAGIC = 0x31534B50; // "PKS1"
+
+void initWaveform();
+// Returns the request's serial; only the envelope for the latest request
+// is ever handed out, so a track from the previous folder can't match.
+uint32_t requestWaveform(const String &path);
+// Copies WAVEFORM_BINS {min, max} pairs, full scale +-127, into peaks.
+bool waveformFor(uint32_t request, int8_t *peaks);
+
+// Capture side, called from Task_Audio only. Begin at the start of a
+// track; any seek aborts, since the envelope must cover every frame.
+void waveformCaptureBegin(const char *path, uint32_t sampleRate, uint32_t durationMs);
+void waveformCaptureFrames(const int16_t *frames, size_t frameCount);
+void waveformCaptureAbort();
+void waveformCaptureEnd();
+
+#endif
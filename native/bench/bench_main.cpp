@@ -0,0 +1,266 @@
+// Host benchmarks for the player logic, built by `pio run -e native`.
+// Runs against the shims in native/shims: SD is a temp directory, the
+// display a framebuffer, FreeRTOS tasks are threads.
+
+#include <Arduino.h>
+#include "M5Cardputer.h"
+#include "audio_config.h"
+#include "file_manager.h"
+#include "ui_manager.h"
+#include "frame_scheduler.h"
+#include "player_control.h"
+#include "playback_state.h"
+#include "album_art.h"
+#include "decode_bench.h"
+#include "sd_clock.h"
+#include "signal_gen.h"
+#include "decode_cost.h"
+#include "time_stretch.h"
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+void setup();
+void Task_Audio(void *pvParameters);
+
+static thread_local uint64_t threadAllocs = 0;
+static thread_local uint64_t threadAllocBytes = 0;
+
+void *operator new(size_t size) {
+    ++threadAllocs;
+    threadAllocBytes += size;
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+// Sparse files that start with two 128 kbps / 44.1 kHz layer III frame
+// headers, which is all the scan-time probe looks at.
+static void makeFile(const std::string &path, off_t size) {
+    static const uint8_t header[4] = {0xFF, 0xFB, 0x90, 0x64};
+    const off_t frameLength = 417;
+    int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0) return;
+    if (size >= 2 * frameLength) {
+        if (pwrite(fd, header, sizeof(header), 0) != sizeof(header) ||
+            pwrite(fd, header, sizeof(header), frameLength) != sizeof(header)) {
+            perror("pwrite");
+        }
+    }
+    if (size > 0 && ftruncate(fd, size) != 0) perror("ftruncate");
+    close(fd);
+}
+
+static std::string makeFolder(const std::string &root, const char *name, uint32_t tracks, off_t size) {
+    std::string dir = root + "/" + name;
+    mkdir(dir.c_str(), 0755);
+    char file[64];
+    for (uint32_t i = 0; i < tracks; ++i) {
+        snprintf(file, sizeof(file), "/%05u - Track %u.mp3", i, i);
+        makeFile(dir + file, size);
+    }
+    return dir;
+}
+
+struct Summary {
+    double avg;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t max;
+};
+
+static Summary summarize(std::vector<uint32_t> samples) {
+    Summary s = {};
+    if (samples.empty()) return s;
+    std::sort(samples.begin(), samples.end());
+    uint64_t total = 0;
+    for (uint32_t v : samples) total += v;
+    s.avg = (double)total / samples.size();
+    s.p50 = samples[samples.size() / 2];
+    s.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    s.max = samples.back();
+    return s;
+}
+
+static void benchScan(const std::string &root) {
+    static const uint32_t sizes[] = {16, 128, 1024, 4096};
+    Serial.println("\n== Directory scan (1 KB .mp3 files, probed) ==");
+    Serial.println("files    cold_us   warm_us   playlist_us  name_us");
+    for (uint32_t n : sizes) {
+        char name[32];
+        snprintf(name, sizeof(name), "scan%u", n);
+        makeFolder(root, name, n, 1024);
+        String folder = String("/") + name;
+
+        unsigned long start = micros();
+        openDirectory(folder);
+        unsigned long cold = micros() - start;
+
+        start = micros();
+        openDirectory(folder);
+        unsigned long warm = micros() - start;
+
+        start = micros();
+        loadPlaylist(folder);
+        unsigned long playlist = micros() - start;
+
+        start = micros();
+        for (uint32_t i = 0; i < fileCount; ++i) getFileName((i * 7919) % fileCount);
+        unsigned long names = fileCount ? (micros() - start) / fileCount : 0;
+
+        Serial.printf("%-8u %-9lu %-9lu %-12lu %lu\n", n, cold, warm, playlist, names);
+    }
+}
+
+static void writeWav(const std::string &path, uint32_t rate, uint16_t channels, uint32_t seconds) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) return;
+    uint32_t frames = rate * seconds;
+    uint32_t dataBytes = frames * channels * 2;
+    uint32_t riffBytes = 36 + dataBytes;
+    uint32_t byteRate = rate * channels * 2;
+    uint16_t blockAlign = channels * 2, bits = 16, format = 1;
+    uint32_t fmtBytes = 16;
+    fwrite("RIFF", 1, 4, f); fwrite(&riffBytes, 4, 1, f); fwrite("WAVEfmt ", 1, 8, f);
+    fwrite(&fmtBytes, 4, 1, f); fwrite(&format, 2, 1, f); fwrite(&channels, 2, 1, f);
+    fwrite(&rate, 4, 1, f); fwrite(&byteRate, 4, 1, f); fwrite(&blockAlign, 2, 1, f); fwrite(&bits, 2, 1, f);
+    fwrite("data", 1, 4, f); fwrite(&dataBytes, 4, 1, f);
+    for (uint32_t i = 0; i < frames; ++i) {
+        int16_t s = (int16_t)(8000 * sin(2 * M_PI * 440.0 * i / rate));
+        for (uint16_t c = 0; c < channels; ++c) fwrite(&s, 2, 1, f);
+    }
+    fclose(f);
+}
+
+// Uses <root>/bench when present (see tools/make_bench_corpus.py), otherwise
+// a pair of WAV files so the harness itself is exercised.
+static void benchDecode(const std::string &root) {
+    Serial.println("\n== Decoder real-time factor ==");
+    std::string dir = root + DECODE_BENCH_DIR;
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0) {
+        mkdir(dir.c_str(), 0755);
+        writeWav(dir + "/wav_44k1_s16_stereo.wav", 44100, 2, 20);
+        writeWav(dir + "/wav_48k_s16_stereo.wav", 48000, 2, 20);
+    }
+
+    uint32_t before = decodeBenchRuns();
+    sendDecodeBenchmark(DECODE_BENCH_DIR);
+    unsigned long start = millis();
+    while (decodeBenchRuns() == before && millis() - start < DECODE_BENCH_TIMEOUT_MS) delay(20);
+}
+
+static void benchFrames(uint32_t frames) {
+    Serial.println("\n== Player frame render ==");
+    openDirectory("/music");
+    handleKeyPress('.'); // /music has no subfolders: [..] then the confirm button
+    handleKeyPress('\n');
+
+    // Task_Audio plays the boot test tone before it services commands.
+    unsigned long waitStart = millis();
+    while (!audio.isRunning() && millis() - waitStart < 5000) {
+        processPlayerEvents();
+        delay(10);
+    }
+    Serial.printf("playback %s\n", audio.isRunning() ? "running" : "NOT running");
+
+    std::vector<uint32_t> times, allocs, bytes;
+    times.reserve(frames);
+    allocs.reserve(frames);
+    bytes.reserve(frames);
+    for (uint32_t i = 0; i < frames; ++i) {
+        processPlayerEvents();
+        uint64_t a0 = threadAllocs, b0 = threadAllocBytes;
+        unsigned long start = micros();
+        draw();
+        times.push_back(micros() - start);
+        allocs.push_back((uint32_t)(threadAllocs - a0));
+        bytes.push_back((uint32_t)(threadAllocBytes - b0));
+        if (i % 8 == 7) handleKeyPress(i % 16 == 7 ? '.' : ';');
+        delay(2);
+    }
+
+    Summary t = summarize(times), a = summarize(allocs), b = summarize(bytes);
+    Serial.printf("frames=%u\n", frames);
+    Serial.printf("render us    avg=%.1f p50=%u p99=%u max=%u\n", t.avg, t.p50, t.p99, t.max);
+    Serial.printf("allocs/frame avg=%.2f p50=%u p99=%u max=%u\n", a.avg, a.p50, a.p99, a.max);
+    Serial.printf("bytes/frame  avg=%.1f p50=%u p99=%u max=%u\n", b.avg, b.p50, b.p99, b.max);
+}
+
+// --serve runs the firmware as on device, with its serial port on a pty for
+// tools/remote.py; the log goes there too.
+static int serve(const char *root) {
+    const char *pty = Serial.openPty();
+    if (!pty) {
+        perror("openpty");
+        return 1;
+    }
+    fprintf(stderr, "SD root: %s\nserial: %s\n", root, pty);
+    setup();
+    while (true) delay(1000);
+}
+
+int main(int argc, char **argv) {
+    bool serveMode = argc > 1 && strcmp(argv[1], "--serve") == 0;
+    uint32_t frames = argc > 1 && !serveMode ? strtoul(argv[1], nullptr, 10) : 600;
+
+    char tmpl[] = "/tmp/cardputer-bench-XXXXXX";
+    const char *root = argc > 2 ? argv[2] : mkdtemp(tmpl);
+    if (!root) {
+        perror("mkdtemp");
+        return 1;
+    }
+    sdShimSetRoot(root);
+    initDecodeCosts();
+    if (argc <= 2) {
+        makeFolder(root, "music", 64, 4 * 1024 * 1024);
+        makeFolder(root, "more", 256, 1024 * 1024);
+    }
+    if (serveMode) return serve(root);
+    Serial.printf("SD root: %s\n", root);
+
+    TaskHandle_t audioTask = NULL;
+    xTaskCreatePinnedToCore(Task_Audio, "Task_Audio", 12288, NULL, 3, &audioTask, 1);
+    initPlayerControl(audioTask);
+
+    initFrameScheduler(NULL);
+    initUI();
+    initSDCard();
+    initAlbumArt();
+    initPlaybackState();
+
+    Serial.println("\n== SD read throughput (host filesystem) ==");
+    SdBenchResult sdResults[8];
+    sdBenchmark(sdResults, 8);
+
+    Serial.println("\n== Signal generator (44.1 kHz stereo, 256-frame blocks) ==");
+    signalBenchmark(1 << 20);
+
+    Serial.println("\n== Time-stretch (44.1 kHz stereo sweep, 60 s of input per speed) ==");
+    timeStretchBenchmark(60);
+
+    benchScan(root);
+    benchDecode(root);
+    benchFrames(frames);
+
+    DirCacheStats dc = getDirCacheStats();
+    Serial.printf("\ndir cache hits=%u misses=%u evictions=%u bytes=%u\n", dc.hits, dc.misses, dc.evictions, dc.bytes);
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,185 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Host-side stand-in for the parts of arduino-esp32 the player uses.
+// Only meant for env:native builds (benchmarks); behaviour is simplified.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#define PROGMEM
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 1
+#define OUTPUT 2
+#define INPUT_PULLUP 5
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+typedef int esp_err_t;
+
+using std::min;
+using std::max;
+
+class String {
+public:
+    String(const char *s = "") : s(s ? s : "") {}
+    String(const std::string &str) : s(str) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(float v, unsigned decimals = 2);
+
+    unsigned length() const { return s.size(); }
+    const char *c_str() const { return s.c_str(); }
+    bool reserve(unsigned n) { s.reserve(n); return true; }
+    bool isEmpty() const { return s.empty(); }
+
+    String substring(unsigned from) const { return from >= s.size() ? String() : String(s.substr(from)); }
+    String substring(unsigned from, unsigned to) const;
+    int indexOf(char c, unsigned from = 0) const { return find(s.find(c, from)); }
+    int indexOf(const String &str) const { return find(s.find(str.s)); }
+    int lastIndexOf(char c) const { return find(s.rfind(c)); }
+    int lastIndexOf(const String &str) const { return find(s.rfind(str.s)); }
+    bool startsWith(const String &p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+    bool endsWith(const String &p) const { return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0; }
+    bool equals(const String &o) const { return s == o.s; }
+    int compareTo(const String &o) const { return s.compare(o.s); }
+    bool equalsIgnoreCase(const String &o) const { return strcasecmp(s.c_str(), o.s.c_str()) == 0; }
+    void toLowerCase() { for (auto &c : s) c = tolower((unsigned char)c); }
+    void toUpperCase() { for (auto &c : s) c = toupper((unsigned char)c); }
+    void trim();
+    void replace(const String &from, const String &to);
+    void remove(unsigned index) { if (index < s.size()) s.erase(index); }
+    void remove(unsigned index, unsigned count) { if (index < s.size()) s.erase(index, count); }
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return atof(s.c_str()); }
+
+    char charAt(unsigned i) const { return i < s.size() ? s[i] : 0; }
+    char operator[](unsigned i) const { return charAt(i); }
+    char &operator[](unsigned i) { return s[i]; }
+
+    String &operator+=(const String &o) { s += o.s; return *this; }
+    String &operator+=(const char *o) { s += o; return *this; }
+    String &operator+=(char c) { s += c; return *this; }
+    String &operator+=(int v) { s += std::to_string(v); return *this; }
+    String &operator+=(unsigned long v) { s += std::to_string(v); return *this; }
+    bool concat(const char *p, unsigned n) { s.append(p, n); return true; }
+
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    bool operator==(const char *o) const { return s == o; }
+    bool operator!=(const char *o) const { return s != o; }
+    bool operator<(const String &o) const { return s < o.s; }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s); }
+    friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+    friend String operator+(const String &a, char b) { return String(a.s + b); }
+    friend String operator+(const String &a, int b) { return String(a.s + std::to_string(b)); }
+
+private:
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    std::string s;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t *buf, size_t len) = 0;
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t println() { return print("\n"); }
+    size_t println(const char *s) { return print(s) + println(); }
+    size_t println(const String &s) { return println(s.c_str()); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    size_t readBytes(uint8_t *buf, size_t len);
+    virtual void flush() {}
+};
+
+// stdin/stdout console standing in for the USB CDC port; openPty() moves it
+// onto a pseudo-terminal so host tools can talk to it like the real port.
+class HostSerial : public Stream {
+public:
+    const char *openPty();
+    void begin(unsigned long) {}
+    operator bool() const { return true; }
+    void setRxBufferSize(size_t) {}
+    void setTxTimeoutMs(uint32_t) {}
+    size_t write(const uint8_t *buf, size_t len) override;
+    int available() override;
+    int read() override;
+    void flush() override;
+
+private:
+    int inFd = 0;
+    int outFd = -1;
+};
+extern HostSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+template <class T, class L, class H> T constrain(T x, L lo, H hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint32_t analogReadMilliVolts(uint8_t pin);
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+const char *esp_err_to_name(esp_err_t err);
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
+
+struct EspClass {
+    uint32_t getFreeHeap() { return heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+    uint32_t getMaxAllocHeap() { return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); }
+    uint32_t getMinFreeHeap() { return heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT); }
+    void restart() { exit(0); }
+    uint32_t getCycleCount();
+};
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef NATIVE_AUDIO_H
+#define NATIVE_AUDIO_H
+
+// Host stand-in for ESP32-audioI2S. 16-bit PCM WAV is read for real; other
+// formats "decode" silence for the length implied by the file size at
+// 128 kbit/s. Either way PCM reaches audio_process_i2s in 1152-frame
+// chunks, so the output stage runs as it does on device.
+
+#include <Arduino.h>
+#include <FS.h>
+
+void audio_process_i2s(int16_t *outBuff, uint16_t validSamples, uint8_t bitsPerSample, uint8_t channels, bool *continueI2S);
+void audio_eof_mp3(const char *info);
+
+class Audio {
+public:
+    bool connecttoFS(fs::FS &fs, const char *path, int32_t resumeFilePos = -1);
+    void loop();
+    void stopSong();
+    bool isRunning() { return running; }
+    uint32_t inBufferFilled() { return running ? 4096 : 0; }
+    uint32_t getSampleRate() { return sampleRate; }
+    uint32_t getBitRate() { return bitRate; }
+    uint8_t getChannels() { return channels; }
+    uint8_t getBitsPerSample() { return 16; }
+    uint32_t getAudioCurrentTime() { return framesOut / sampleRate; }
+    uint32_t getAudioFileDuration() { return headerParsed ? totalFrames / sampleRate : 0; }
+    bool setAudioPlayPosition(uint16_t sec);
+    bool setFilePos(uint32_t pos);
+    void setVolume(uint8_t vol) { volume = vol; }
+    uint8_t getVolume() { return volume; }
+    void setVolumeSteps(uint8_t steps) { volumeSteps = steps; }
+    void setBalance(int8_t bal) { balance = bal; }
+
+private:
+    bool openWav();
+
+    bool running = false;
+    bool headerParsed = false; // like the library, only after the first loop()
+    File file;
+    bool wav = false;
+    uint32_t dataStart = 0;
+    uint8_t channels = 2;
+    uint32_t bitRate = 0;
+    uint32_t sampleRate = 44100;
+    uint64_t totalFrames = 0;
+    uint64_t framesOut = 0;
+    uint8_t volume = 0;
+    uint8_t volumeSteps = 21;
+    int8_t balance = 0;
+    String path;
+};
+
+#endif
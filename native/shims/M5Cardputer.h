@@ -0,0 +1,215 @@
+#ifndef NATIVE_M5CARDPUTER_H
+#define NATIVE_M5CARDPUTER_H
+
+// Host stand-in for M5Cardputer/M5Unified/M5GFX. Canvases and the display
+// are plain RGB565 framebuffers (byte-swapped, as M5GFX stores them), so
+// render cost and allocations can be measured off-device.
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+struct GFXglyph {
+    uint16_t bitmapOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+};
+
+struct GFXfont {
+    uint8_t *bitmap;
+    GFXglyph *glyph;
+    uint16_t first;
+    uint16_t last;
+    uint8_t yAdvance;
+};
+
+// Plain integer constants, as in LovyanGFX, so colours mix freely with
+// uint16_t in conditionals.
+constexpr uint16_t BLACK = 0x0000;
+constexpr uint16_t NAVY = 0x000F;
+constexpr uint16_t DARKGREEN = 0x03E0;
+constexpr uint16_t MAROON = 0x7800;
+constexpr uint16_t PURPLE = 0x780F;
+constexpr uint16_t OLIVE = 0x7BE0;
+constexpr uint16_t LIGHTGREY = 0xD69A;
+constexpr uint16_t DARKGREY = 0x7BEF;
+constexpr uint16_t BLUE = 0x001F;
+constexpr uint16_t GREEN = 0x07E0;
+constexpr uint16_t CYAN = 0x07FF;
+constexpr uint16_t RED = 0xF800;
+constexpr uint16_t MAGENTA = 0xF81F;
+constexpr uint16_t YELLOW = 0xFFE0;
+constexpr uint16_t WHITE = 0xFFFF;
+constexpr uint16_t ORANGE = 0xFDA0;
+constexpr uint16_t TFT_BLACK = BLACK;
+constexpr uint16_t TFT_WHITE = WHITE;
+
+namespace lgfx {
+struct DataWrapper {
+    virtual ~DataWrapper() {}
+    virtual int read(uint8_t *buf, uint32_t len) = 0;
+    virtual void skip(int32_t offset) = 0;
+    virtual bool seek(uint32_t offset) = 0;
+    virtual void close() = 0;
+    virtual int32_t tell() = 0;
+    bool need_transaction = false;
+};
+} // namespace lgfx
+
+class LovyanGFX {
+public:
+    LovyanGFX() {}
+    virtual ~LovyanGFX() {}
+
+    int32_t width() const { return w; }
+    int32_t height() const { return h; }
+    void *getBuffer() { return pixels.empty() ? nullptr : pixels.data(); }
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color);
+    void drawFastHLine(int32_t x, int32_t y, int32_t len, uint32_t color) { fillRect(x, y, len, 1, color); }
+    void drawFastVLine(int32_t x, int32_t y, int32_t len, uint32_t color) { fillRect(x, y, 1, len, color); }
+    void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+    void fillRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color);
+    void drawRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color);
+    void fillRoundRect(int32_t x, int32_t y, int32_t rw, int32_t rh, int32_t r, uint32_t color);
+    void drawRoundRect(int32_t x, int32_t y, int32_t rw, int32_t rh, int32_t r, uint32_t color);
+    void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color);
+    void fillScreen(uint32_t color) { fillRect(0, 0, w, h, color); }
+    void fillSprite(uint32_t color) { fillScreen(color); }
+    void pushImage(int32_t x, int32_t y, int32_t iw, int32_t ih, const uint16_t *data);
+
+    void setTextFont(int) { font = nullptr; }
+    void setFont(const GFXfont *f) { font = f; }
+    void setTextColor(uint32_t fg) { textFg = fg; textBg = fg; }
+    void setTextColor(uint32_t fg, uint32_t bg) { textFg = fg; textBg = bg; }
+    void setTextDatum(uint8_t d) { datum = d; }
+    void setTextSize(float s) { textSize = s < 1 ? 1 : (int)s; }
+    int32_t textWidth(const char *s);
+    int32_t textWidth(const String &s) { return textWidth(s.c_str()); }
+    size_t drawString(const char *s, int32_t x, int32_t y);
+    size_t drawString(const String &s, int32_t x, int32_t y) { return drawString(s.c_str(), x, y); }
+
+    bool drawJpg(lgfx::DataWrapper *data, int32_t x = 0, int32_t y = 0, int32_t maxW = 0, int32_t maxH = 0,
+                 int32_t offX = 0, int32_t offY = 0, float scaleX = 1.0f, float scaleY = 0.0f);
+
+    uint16_t color565(uint8_t r, uint8_t g, uint8_t b) { return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3); }
+    void setRotation(uint8_t) {}
+    void setBrightness(uint8_t b) { brightness = b; }
+    uint8_t getBrightness() const { return brightness; }
+    void setSwapBytes(bool) {}
+    void sleep() {}
+    void wakeup() {}
+    void startWrite() {}
+    void endWrite() {}
+    void waitDMA() {}
+
+    void blitFrom(const LovyanGFX &src, int32_t x, int32_t y);
+
+protected:
+    void allocate(int32_t nw, int32_t nh);
+
+    int32_t w = 0;
+    int32_t h = 0;
+    std::vector<uint16_t> pixels;
+
+private:
+    int32_t drawGlyph(char c, int32_t x, int32_t y);
+
+    const GFXfont *font = nullptr;
+    uint32_t textFg = WHITE;
+    uint32_t textBg = WHITE;
+    uint8_t datum = 0;
+    int textSize = 1;
+    uint8_t brightness = 128;
+};
+
+class M5Canvas : public LovyanGFX {
+public:
+    M5Canvas() {}
+    explicit M5Canvas(LovyanGFX *parent) : parent(parent) {}
+
+    void *createSprite(int32_t sw, int32_t sh) {
+        allocate(sw, sh);
+        return getBuffer();
+    }
+    void deleteSprite() { allocate(0, 0); }
+    void setColorDepth(int) {}
+    void setPsram(bool) {}
+    void pushSprite(int32_t x, int32_t y) { pushSprite(parent, x, y); }
+    void pushSprite(LovyanGFX *dst, int32_t x, int32_t y) { if (dst) dst->blitFrom(*this, x, y); }
+
+private:
+    LovyanGFX *parent = nullptr;
+};
+
+class HostDisplay : public LovyanGFX {
+public:
+    HostDisplay() { allocate(240, 135); }
+};
+
+class KeyboardReader {
+public:
+    virtual ~KeyboardReader() {}
+};
+
+class Keyboard_Class {
+public:
+    struct KeysState {
+        std::vector<char> word;
+        std::vector<uint8_t> hid_keys;
+        std::vector<uint8_t> modifier_keys;
+        bool tab = false, fn = false, shift = false, ctrl = false, opt = false, alt = false;
+        bool del = false, enter = false, space = false;
+        uint8_t modifiers = 0;
+    };
+
+    void begin(std::unique_ptr<KeyboardReader> reader) { this->reader = std::move(reader); }
+    void updateKeyList() {}
+    void updateKeysState() {}
+    bool isChange() { return false; }
+    bool isPressed() { return false; }
+    KeysState &keysState() { return state; }
+
+private:
+    std::unique_ptr<KeyboardReader> reader;
+    KeysState state;
+};
+
+struct Power_Class {
+    int32_t getBatteryLevel() { return 80; }
+    int16_t getBatteryVoltage() { return 3950; }
+};
+
+// In-memory register file per I2C address, so codec drivers can write and
+// read back as they would on the bus.
+struct I2C_Class {
+    bool writeRegister(uint8_t addr, uint8_t reg, const uint8_t *data, size_t len, uint32_t freq);
+    bool readRegister(uint8_t addr, uint8_t reg, uint8_t *data, size_t len, uint32_t freq);
+};
+
+struct M5Config {
+    uint32_t serial_baudrate = 115200;
+    bool internal_mic = true;
+    bool internal_spk = true;
+};
+
+struct M5Unified {
+    M5Config config() { return M5Config(); }
+    I2C_Class In_I2C;
+    Power_Class Power;
+};
+extern M5Unified M5;
+
+struct M5Cardputer_Class {
+    void begin(const M5Config &, bool = false) {}
+    void update() {}
+    HostDisplay Display;
+    Keyboard_Class Keyboard;
+    Power_Class Power;
+};
+extern M5Cardputer_Class M5Cardputer;
+
+#endif
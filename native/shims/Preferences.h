@@ -0,0 +1,41 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+// In-memory NVS: namespaces persist for the life of the process only.
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false);
+    void end();
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putBytes(const char *key, const void *value, size_t len);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+    size_t getBytesLength(const char *key);
+
+    size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint8_t getUChar(const char *key, uint8_t def = 0) { return getValue(key, def); }
+    size_t putBool(const char *key, bool value) { return putUChar(key, value); }
+    bool getBool(const char *key, bool def = false) { return getUChar(key, def) != 0; }
+    size_t putInt(const char *key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+    int32_t getInt(const char *key, int32_t def = 0) { return getValue(key, def); }
+    size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint32_t getUInt(const char *key, uint32_t def = 0) { return getValue(key, def); }
+    size_t putString(const char *key, const String &value) { return putBytes(key, value.c_str(), value.length() + 1); }
+    String getString(const char *key, const String &def = String());
+
+private:
+    template <typename T> T getValue(const char *key, T def) {
+        T value;
+        return getBytesLength(key) == sizeof(T) && getBytes(key, &value, sizeof(T)) == sizeof(T) ? value : def;
+    }
+
+    String space;
+    bool opened = false;
+};
+
+#endif
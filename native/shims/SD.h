@@ -0,0 +1,41 @@
+#ifndef NATIVE_SD_H
+#define NATIVE_SD_H
+
+#include <Arduino.h>
+#include "FS.h"
+#include "SPI.h"
+
+enum sdcard_type_t {
+    CARD_NONE,
+    CARD_MMC,
+    CARD_SD,
+    CARD_SDHC,
+    CARD_UNKNOWN
+};
+
+namespace fs {
+
+// SD card backed by a host directory (see sdShimSetRoot / $SD_ROOT).
+class SDFS : public FS {
+public:
+    bool begin(uint8_t ssPin = 12, SPIClass &spi = SPI, uint32_t frequency = 4000000,
+               const char *mountpoint = "/sd", uint8_t maxFiles = 5, bool formatIfEmpty = false);
+    void end() {}
+    sdcard_type_t cardType() { return CARD_SDHC; }
+    uint64_t cardSize() { return 16ULL * 1024 * 1024 * 1024; }
+    uint64_t totalBytes() { return cardSize(); }
+    uint64_t usedBytes() { return 0; }
+    size_t numSectors() { return cardSize() / 512; }
+    size_t sectorSize() { return 512; }
+    // Raw sectors are synthesised from the sector number; there is no block device.
+    bool readRAW(uint8_t *buffer, uint32_t sector);
+};
+
+} // namespace fs
+
+extern fs::SDFS SD;
+
+void sdShimSetRoot(const char *hostPath);
+const char *sdShimRoot();
+
+#endif
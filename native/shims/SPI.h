@@ -0,0 +1,16 @@
+#ifndef NATIVE_SPI_H
+#define NATIVE_SPI_H
+
+#include <Arduino.h>
+
+class SPIClass {
+public:
+    explicit SPIClass(uint8_t = 0) {}
+    void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+    void end() {}
+    void setFrequency(uint32_t) {}
+};
+
+extern SPIClass SPI;
+
+#endif
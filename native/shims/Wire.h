@@ -0,0 +1,15 @@
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+    bool end() { return true; }
+    void setTimeOut(uint16_t) {}
+};
+
+extern TwoWire Wire;
+
+#endif
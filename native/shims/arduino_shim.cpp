@@ -0,0 +1,201 @@
+#include "Arduino.h"
+#include <chrono>
+#include <random>
+#include <stdarg.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <mutex>
+#include <termios.h>
+
+HostSerial Serial;
+EspClass ESP;
+
+static const auto bootTime = std::chrono::steady_clock::now();
+static std::mt19937 rng(1);
+static uint32_t cpuMhz = 240;
+
+// The TSC where there is one, otherwise nanoseconds scaled to the emulated
+// clock; either way only differences are meaningful.
+uint32_t EspClass::getCycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#else
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - bootTime).count();
+    return (uint32_t)(ns * cpuMhz / 1000);
+#endif
+}
+
+String::String(float v, unsigned decimals) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    s = buf;
+}
+
+String String::substring(unsigned from, unsigned to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s.size()) return String();
+    return String(s.substr(from, std::min<size_t>(to, s.size()) - from));
+}
+
+void String::trim() {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    size_t b = s.find_last_not_of(" \t\r\n");
+    s = (a == std::string::npos) ? std::string() : s.substr(a, b - a + 1);
+}
+
+void String::replace(const String &from, const String &to) {
+    if (from.s.empty()) return;
+    size_t pos = 0;
+    while ((pos = s.find(from.s, pos)) != std::string::npos) {
+        s.replace(pos, from.s.size(), to.s);
+        pos += to.s.size();
+    }
+}
+
+size_t Print::printf(const char *fmt, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (len < 0) return 0;
+    return write((const uint8_t *)buf, std::min<size_t>(len, sizeof(buf) - 1));
+}
+
+size_t Stream::readBytes(uint8_t *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        int c = read();
+        if (c < 0) break;
+        buf[got++] = c;
+    }
+    return got;
+}
+
+static std::mutex serialWriteLock;
+
+const char *HostSerial::openPty() {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return nullptr;
+    const char *name = ptsname(master);
+    // Keep the slave open in raw mode so nothing is echoed or line-edited and
+    // the master doesn't see EIO while no client is attached.
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0) return nullptr;
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fflush(stdout);
+    inFd = master;
+    outFd = master;
+    return name;
+}
+
+size_t HostSerial::write(const uint8_t *buf, size_t len) {
+    std::lock_guard<std::mutex> lock(serialWriteLock);
+    if (outFd < 0) return fwrite(buf, 1, len, stdout);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = ::write(outFd, buf + done, len - done);
+        if (n <= 0) break;
+        done += n;
+    }
+    return done;
+}
+
+int HostSerial::available() {
+    struct pollfd pfd = {inFd, POLLIN, 0};
+    return poll(&pfd, 1, 0) > 0 ? 1 : 0;
+}
+
+int HostSerial::read() {
+    if (!available()) return -1;
+    unsigned char c;
+    return ::read(inFd, &c, 1) == 1 ? c : -1;
+}
+
+void HostSerial::flush() {
+    if (outFd < 0) fflush(stdout);
+}
+
+unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(ms);
+}
+
+void delayMicroseconds(uint32_t us) {
+    usleep(us);
+}
+
+void yield() {}
+
+long random(long max) {
+    return max > 0 ? std::uniform_int_distribution<long>(0, max - 1)(rng) : 0;
+}
+
+long random(long min, long max) {
+    return max > min ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+    rng.seed(seed);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// No GPIO on the host: writes are dropped, reads return idle levels
+// (headphone detect high = unplugged, keyboard INT high = no event).
+void pinMode(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return HIGH; }
+void digitalWrite(uint8_t, uint8_t) {}
+uint32_t analogReadMilliVolts(uint8_t) { return 0; }
+void attachInterrupt(uint8_t, void (*)(void), int) {}
+void detachInterrupt(uint8_t) {}
+
+bool setCpuFrequencyMhz(uint32_t mhz) {
+    cpuMhz = mhz;
+    return true;
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return cpuMhz;
+}
+
+const char *esp_err_to_name(esp_err_t err) {
+    return err == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+size_t heap_caps_get_free_size(unsigned) {
+    return 300 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(unsigned) {
+    return 200 * 1024;
+}
+
+size_t heap_caps_get_minimum_free_size(unsigned) {
+    return 250 * 1024;
+}
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = std::min(len, size - 1);
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
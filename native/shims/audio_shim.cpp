@@ -0,0 +1,305 @@
+#include <Audio.h>
+#include <Preferences.h>
+#include <driver/i2s.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ---- I2S -----------------------------------------------------------------
+
+struct I2SPort {
+    bool installed = false;
+    bool running = false;
+    uint32_t rate = 44100;
+    uint32_t dmaLen = 256;
+    uint32_t capacity = 6 * 256;
+    QueueHandle_t events = nullptr;
+    uint64_t written = 0;
+    uint64_t reported = 0;
+    uint64_t anchorUs = 0;
+    uint64_t anchorFrames = 0;
+};
+
+static I2SPort ports[I2S_NUM_MAX];
+
+static uint64_t played(I2SPort &p) {
+    if (!p.running) return p.anchorFrames;
+    uint64_t frames = p.anchorFrames + ((uint64_t)micros() - p.anchorUs) * p.rate / 1000000ULL;
+    return std::min(frames, p.written);
+}
+
+static void reanchor(I2SPort &p) {
+    p.anchorFrames = played(p);
+    p.anchorUs = (uint64_t)micros();
+}
+
+static void postCompleted(I2SPort &p) {
+    uint64_t done = played(p);
+    while (p.reported + p.dmaLen <= done) {
+        p.reported += p.dmaLen;
+        i2s_event_t evt = {I2S_EVENT_TX_DONE, p.dmaLen * 4};
+        if (p.events) xQueueSend(p.events, &evt, 0);
+    }
+}
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queueSize, QueueHandle_t *queue) {
+    I2SPort &p = ports[port];
+    if (p.installed) return ESP_FAIL;
+    p = I2SPort();
+    p.installed = true;
+    p.running = true;
+    p.rate = config->sample_rate;
+    p.dmaLen = config->dma_buf_len;
+    p.capacity = config->dma_buf_count * config->dma_buf_len;
+    p.anchorUs = (uint64_t)micros();
+    if (queue) {
+        p.events = xQueueCreate(queueSize, sizeof(i2s_event_t));
+        *queue = p.events;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port) {
+    ports[port].installed = false;
+    ports[port].running = false;
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *) {
+    return ports[port].installed ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, i2s_bits_per_sample_t, i2s_channel_t) {
+    I2SPort &p = ports[port];
+    if (!p.installed || rate == 0) return ESP_FAIL;
+    reanchor(p);
+    p.rate = rate;
+    return ESP_OK;
+}
+
+esp_err_t i2s_write(i2s_port_t port, const void *, size_t size, size_t *written, TickType_t) {
+    I2SPort &p = ports[port];
+    if (!p.installed) return ESP_FAIL;
+    uint64_t frames = size / 4;
+    if (p.running && played(p) >= p.written) {
+        // Ring ran dry: playback restarts from whatever arrives now.
+        p.anchorFrames = p.written;
+        p.anchorUs = (uint64_t)micros();
+    }
+    while (p.running) {
+        postCompleted(p);
+        uint64_t queued = p.written - played(p);
+        if (queued + frames <= p.capacity) break;
+        uint64_t excess = queued + frames - p.capacity;
+        delayMicroseconds((uint32_t)(excess * 1000000ULL / p.rate) + 1);
+    }
+    p.written += frames;
+    *written = size;
+    return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port) {
+    I2SPort &p = ports[port];
+    p.written = played(p);
+    reanchor(p);
+    return ESP_OK;
+}
+
+esp_err_t i2s_start(i2s_port_t port) {
+    I2SPort &p = ports[port];
+    p.anchorUs = (uint64_t)micros();
+    p.running = true;
+    return ESP_OK;
+}
+
+esp_err_t i2s_stop(i2s_port_t port) {
+    I2SPort &p = ports[port];
+    reanchor(p);
+    p.running = false;
+    return ESP_OK;
+}
+
+// ---- Decoder ---------------------------------------------------------------
+
+static constexpr uint32_t DECODE_FRAMES = 1152;
+static constexpr uint32_t NOMINAL_BITRATE = 128000;
+
+bool Audio::openWav() {
+    uint8_t riff[12];
+    if (file.read(riff, 12) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) return false;
+    uint8_t hdr[8];
+    bool fmtOk = false;
+    while (file.read(hdr, 8) == 8) {
+        uint32_t len = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+        if (memcmp(hdr, "fmt ", 4) == 0 && len >= 16) {
+            uint8_t fmt[16];
+            file.read(fmt, 16);
+            uint16_t format = fmt[0] | (fmt[1] << 8);
+            channels = fmt[2];
+            sampleRate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            fmtOk = format == 1 && (fmt[14] | (fmt[15] << 8)) == 16 && (channels == 1 || channels == 2) && sampleRate > 0;
+            file.seek(file.position() + len - 16 + (len & 1));
+        } else if (memcmp(hdr, "data", 4) == 0) {
+            if (!fmtOk) return false;
+            totalFrames = len / (channels * 2);
+            dataStart = file.position();
+            bitRate = sampleRate * channels * 16;
+            return true;
+        } else {
+            file.seek(file.position() + len + (len & 1));
+        }
+    }
+    return false;
+}
+
+bool Audio::connecttoFS(fs::FS &fs, const char *path, int32_t) {
+    stopSong();
+    file = fs.open(path, FILE_READ);
+    if (!file) return false;
+    this->path = path;
+    String lower = path;
+    lower.toLowerCase();
+    wav = lower.endsWith(".wav");
+    if (wav) {
+        if (!openWav()) {
+            file.close();
+            return false;
+        }
+    } else {
+        sampleRate = 44100;
+        channels = 2;
+        bitRate = NOMINAL_BITRATE;
+        totalFrames = (uint64_t)file.size() * 8 * sampleRate / NOMINAL_BITRATE;
+        file.close();
+    }
+    framesOut = 0;
+    headerParsed = false;
+    running = true;
+    return true;
+}
+
+void Audio::loop() {
+    if (!running) return;
+    if (!headerParsed) {
+        headerParsed = true;
+        return;
+    }
+    if (framesOut >= totalFrames) {
+        stopSong();
+        audio_eof_mp3(path.c_str());
+        return;
+    }
+    static int16_t pcm[DECODE_FRAMES * 2];
+    uint32_t frames = (uint32_t)std::min<uint64_t>(DECODE_FRAMES, totalFrames - framesOut);
+    if (wav) {
+        size_t bytes = file.read((uint8_t *)pcm, frames * channels * 2);
+        frames = bytes / (channels * 2);
+        if (frames == 0) {
+            totalFrames = framesOut;
+            return;
+        }
+        if (channels == 1) {
+            for (int32_t i = frames - 1; i >= 0; --i) pcm[2 * i] = pcm[2 * i + 1] = pcm[i];
+        }
+    } else {
+        memset(pcm, 0, frames * 4);
+    }
+    bool cont = false;
+    audio_process_i2s(pcm, frames, 16, 2, &cont);
+    framesOut += frames;
+}
+
+void Audio::stopSong() {
+    running = false;
+    framesOut = 0;
+    if (file) file.close();
+}
+
+// The library clamps to the duration it has parsed so far.
+bool Audio::setAudioPlayPosition(uint16_t sec) {
+    if (!running) return false;
+    sec = std::min<uint32_t>(sec, getAudioFileDuration());
+    framesOut = std::min<uint64_t>((uint64_t)sec * sampleRate, totalFrames);
+    if (wav) file.seek(dataStart + framesOut * channels * 2);
+    return true;
+}
+
+bool Audio::setFilePos(uint32_t pos) {
+    if (!running || bitRate == 0) return false;
+    uint64_t frames = wav ? (pos > dataStart ? pos - dataStart : 0) / (channels * 2)
+                          : (uint64_t)pos * 8 * sampleRate / bitRate;
+    framesOut = std::min<uint64_t>(frames, totalFrames);
+    if (wav) file.seek(dataStart + framesOut * channels * 2);
+    return true;
+}
+
+// ---- Preferences -----------------------------------------------------------
+
+static std::mutex nvsMutex;
+static std::map<std::string, std::vector<uint8_t>> nvs;
+
+static std::string nvsKey(const String &space, const char *key) {
+    return std::string(space.c_str()) + '\x1f' + key;
+}
+
+bool Preferences::begin(const char *name, bool) {
+    space = name;
+    opened = true;
+    return true;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+bool Preferences::clear() {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    std::string prefix = nvsKey(space, "");
+    for (auto it = nvs.lower_bound(prefix); it != nvs.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+        it = nvs.erase(it);
+    }
+    return opened;
+}
+
+bool Preferences::remove(const char *key) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    return opened && nvs.erase(nvsKey(space, key)) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    return opened && nvs.count(nvsKey(space, key)) > 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+    if (!opened) return 0;
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    const uint8_t *bytes = (const uint8_t *)value;
+    nvs[nvsKey(space, key)].assign(bytes, bytes + len);
+    return len;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    auto it = nvs.find(nvsKey(space, key));
+    if (!opened || it == nvs.end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    auto it = nvs.find(nvsKey(space, key));
+    return opened && it != nvs.end() ? it->second.size() : 0;
+}
+
+String Preferences::getString(const char *key, const String &def) {
+    size_t len = getBytesLength(key);
+    if (len == 0) return def;
+    std::vector<char> buf(len);
+    getBytes(key, buf.data(), len);
+    buf.back() = '\0';
+    return String(buf.data());
+}
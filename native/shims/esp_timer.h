@@ -0,0 +1,27 @@
+#ifndef NATIVE_ESP_TIMER_H
+#define NATIVE_ESP_TIMER_H
+
+#include <stdint.h>
+
+struct ShimEspTimer;
+typedef ShimEspTimer *esp_timer_handle_t;
+
+typedef enum {
+    ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct {
+    void (*callback)(void *arg);
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+int esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle);
+int esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs);
+int esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs);
+int esp_timer_stop(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+// FreeRTOS API mapped onto std::thread / mutex / condition_variable.
+// One tick is one millisecond.
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+struct ShimTask;
+struct ShimSemaphore;
+struct ShimQueue;
+struct ShimTimer;
+typedef ShimTask *TaskHandle_t;
+typedef ShimSemaphore *SemaphoreHandle_t;
+typedef ShimQueue *QueueHandle_t;
+typedef ShimTimer *TimerHandle_t;
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTICKS_TO_MS(t) ((uint32_t)(t))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define tskIDLE_PRIORITY 0
+#define portYIELD_FROM_ISR(...) do {} while (0)
+
+// Critical sections collapse to one process-wide recursive lock.
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+void shimEnterCritical();
+void shimExitCritical();
+#define portENTER_CRITICAL(mux) ((void)(mux), shimEnterCritical())
+#define portEXIT_CRITICAL(mux) ((void)(mux), shimExitCritical())
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux), shimEnterCritical())
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux), shimExitCritical())
+
+#endif
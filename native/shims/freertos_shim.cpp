@@ -0,0 +1,352 @@
+#include "Arduino.h"
+#include "freertos/timers.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct ShimTask {
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notifyValue = 0;
+    bool notified = false;
+    void (*fn)(void *) = nullptr;
+    void *arg = nullptr;
+};
+
+struct ShimSemaphore {
+    std::mutex lock;
+    std::condition_variable cv;
+    int count;
+};
+
+struct ShimQueue {
+    std::mutex lock;
+    std::condition_variable cv;
+    size_t length;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+struct ShimTimer {
+    std::mutex lock;
+    std::condition_variable cv;
+    TickType_t period;
+    bool autoReload;
+    void *id;
+    TimerCallbackFunction_t callback;
+    bool armed = false;
+    Clock::time_point deadline;
+};
+
+static thread_local ShimTask *currentTask = nullptr;
+static std::recursive_mutex criticalLock;
+
+static bool waitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lk, TickType_t ticks,
+                    const std::function<bool()> &ready) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lk, ready);
+        return true;
+    }
+    return cv.wait_for(lk, std::chrono::milliseconds(ticks), ready);
+}
+
+void shimEnterCritical() {
+    criticalLock.lock();
+}
+
+void shimExitCritical() {
+    criticalLock.unlock();
+}
+
+static void taskEntry(ShimTask *task) {
+    currentTask = task;
+    task->fn(task->arg);
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *, uint32_t, void *arg, UBaseType_t,
+                                   TaskHandle_t *handle, BaseType_t) {
+    ShimTask *task = new ShimTask();
+    task->fn = fn;
+    task->arg = arg;
+    if (handle) *handle = task;
+    std::thread(taskEntry, task).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(void (*fn)(void *), const char *name, uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, priority, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // Threads can't be killed from outside; a task deleting itself parks forever.
+    if (task == nullptr || task == currentTask) {
+        for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+    return millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (currentTask == nullptr) currentTask = new ShimTask();
+    return currentTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) {
+    return 4096;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (task == nullptr) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lk(task->lock);
+        switch (action) {
+        case eSetBits: task->notifyValue |= value; break;
+        case eIncrement: task->notifyValue++; break;
+        case eSetValueWithOverwrite: task->notifyValue = value; break;
+        case eNoAction: break;
+        }
+        task->notified = true;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *) {
+    return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *) {
+    xTaskNotify(task, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t ticks) {
+    ShimTask *task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lk(task->lock);
+    if (!task->notified) task->notifyValue &= ~clearOnEntry;
+    bool got = waitFor(task->cv, lk, ticks, [task] { return task->notified; });
+    if (value) *value = task->notifyValue;
+    if (got) {
+        task->notifyValue &= ~clearOnExit;
+        task->notified = false;
+    }
+    return got ? pdTRUE : pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    ShimTask *task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lk(task->lock);
+    waitFor(task->cv, lk, ticks, [task] { return task->notifyValue != 0; });
+    uint32_t value = task->notifyValue;
+    if (value) task->notifyValue = clearOnExit ? 0 : value - 1;
+    task->notified = false;
+    return value;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    ShimSemaphore *sem = new ShimSemaphore();
+    sem->count = 1;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    ShimSemaphore *sem = new ShimSemaphore();
+    sem->count = 0;
+    return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    if (sem == nullptr) return pdFAIL;
+    std::unique_lock<std::mutex> lk(sem->lock);
+    if (!waitFor(sem->cv, lk, ticks, [sem] { return sem->count > 0; })) return pdFALSE;
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (sem == nullptr) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lk(sem->lock);
+        if (sem->count > 0) return pdFALSE;
+        sem->count = 1;
+    }
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *) {
+    return xSemaphoreGive(sem);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    ShimQueue *queue = new ShimQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lk(queue->lock);
+    if (!waitFor(queue->cv, lk, ticks, [queue] { return queue->items.size() < queue->length; })) return pdFALSE;
+    const uint8_t *p = (const uint8_t *)item;
+    queue->items.emplace_back(p, p + queue->itemSize);
+    lk.unlock();
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *) {
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    {
+        std::lock_guard<std::mutex> lk(queue->lock);
+        queue->items.clear();
+        const uint8_t *p = (const uint8_t *)item;
+        queue->items.emplace_back(p, p + queue->itemSize);
+    }
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lk(queue->lock);
+    if (!waitFor(queue->cv, lk, ticks, [queue] { return !queue->items.empty(); })) return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    lk.unlock();
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+// Each software timer gets its own service thread; there are only a handful.
+static void timerThread(ShimTimer *timer) {
+    std::unique_lock<std::mutex> lk(timer->lock);
+    for (;;) {
+        timer->cv.wait(lk, [timer] { return timer->armed; });
+        if (timer->cv.wait_until(lk, timer->deadline) != std::cv_status::timeout) continue;
+        if (!timer->armed || Clock::now() < timer->deadline) continue;
+        if (timer->autoReload) {
+            timer->deadline += std::chrono::milliseconds(timer->period);
+        } else {
+            timer->armed = false;
+        }
+        lk.unlock();
+        timer->callback(timer);
+        lk.lock();
+    }
+}
+
+TimerHandle_t xTimerCreate(const char *, TickType_t period, UBaseType_t autoReload, void *id,
+                           TimerCallbackFunction_t callback) {
+    ShimTimer *timer = new ShimTimer();
+    timer->period = period;
+    timer->autoReload = autoReload;
+    timer->id = id;
+    timer->callback = callback;
+    std::thread(timerThread, timer).detach();
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t) {
+    {
+        std::lock_guard<std::mutex> lk(timer->lock);
+        timer->armed = true;
+        timer->deadline = Clock::now() + std::chrono::milliseconds(timer->period);
+    }
+    timer->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t) {
+    {
+        std::lock_guard<std::mutex> lk(timer->lock);
+        timer->armed = false;
+    }
+    timer->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks) {
+    return xTimerStart(timer, ticks);
+}
+
+BaseType_t xTimerResetFromISR(TimerHandle_t timer, BaseType_t *) {
+    return xTimerStart(timer, 0);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks) {
+    {
+        std::lock_guard<std::mutex> lk(timer->lock);
+        timer->period = period;
+    }
+    return xTimerStart(timer, ticks);
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer) {
+    return timer->id;
+}
+
+struct ShimEspTimer {
+    ShimTimer *timer;
+    void (*callback)(void *);
+    void *arg;
+};
+
+static void espTimerFired(TimerHandle_t timer) {
+    ShimEspTimer *t = (ShimEspTimer *)pvTimerGetTimerID(timer);
+    t->callback(t->arg);
+}
+
+int esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+    ShimEspTimer *t = new ShimEspTimer();
+    t->callback = args->callback;
+    t->arg = args->arg;
+    t->timer = xTimerCreate(args->name, 1, pdFALSE, t, espTimerFired);
+    *handle = t;
+    return ESP_OK;
+}
+
+static int startEspTimer(esp_timer_handle_t t, uint64_t us, bool periodic) {
+    {
+        std::lock_guard<std::mutex> lk(t->timer->lock);
+        t->timer->autoReload = periodic;
+    }
+    xTimerChangePeriod(t->timer, (TickType_t)std::max<uint64_t>(1, us / 1000), 0);
+    return ESP_OK;
+}
+
+int esp_timer_start_once(esp_timer_handle_t t, uint64_t us) {
+    return startEspTimer(t, us, false);
+}
+
+int esp_timer_start_periodic(esp_timer_handle_t t, uint64_t us) {
+    return startEspTimer(t, us, true);
+}
+
+int esp_timer_stop(esp_timer_handle_t t) {
+    xTimerStop(t->timer, 0);
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return micros();
+}
@@ -0,0 +1,194 @@
+#include "M5Cardputer.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+M5Unified M5;
+M5Cardputer_Class M5Cardputer;
+
+static inline uint16_t swap565(uint32_t color) {
+    return (uint16_t)(((color & 0xFF) << 8) | ((color >> 8) & 0xFF));
+}
+
+void LovyanGFX::allocate(int32_t nw, int32_t nh) {
+    w = nw > 0 ? nw : 0;
+    h = nh > 0 ? nh : 0;
+    std::vector<uint16_t>(w * h).swap(pixels);
+}
+
+void LovyanGFX::drawPixel(int32_t x, int32_t y, uint32_t color) {
+    if (x < 0 || y < 0 || x >= w || y >= h) return;
+    pixels[y * w + x] = swap565(color);
+}
+
+void LovyanGFX::fillRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color) {
+    int32_t x0 = std::max<int32_t>(x, 0), y0 = std::max<int32_t>(y, 0);
+    int32_t x1 = std::min<int32_t>(x + rw, w), y1 = std::min<int32_t>(y + rh, h);
+    if (x0 >= x1 || y0 >= y1) return;
+    uint16_t c = swap565(color);
+    for (int32_t row = y0; row < y1; ++row) std::fill(&pixels[row * w + x0], &pixels[row * w + x1], c);
+}
+
+void LovyanGFX::drawRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color) {
+    drawFastHLine(x, y, rw, color);
+    drawFastHLine(x, y + rh - 1, rw, color);
+    drawFastVLine(x, y, rh, color);
+    drawFastVLine(x + rw - 1, y, rh, color);
+}
+
+void LovyanGFX::fillRoundRect(int32_t x, int32_t y, int32_t rw, int32_t rh, int32_t r, uint32_t color) {
+    r = std::min(r, std::min(rw, rh) / 2);
+    for (int32_t row = 0; row < rh; ++row) {
+        int32_t dy = row < r ? r - row : (row >= rh - r ? row - (rh - r - 1) : 0);
+        int32_t inset = 0;
+        while (inset < r && (r - inset) * (r - inset) + dy * dy > r * r) ++inset;
+        if (dy == 0) inset = 0;
+        drawFastHLine(x + inset, y + row, rw - 2 * inset, color);
+    }
+}
+
+void LovyanGFX::drawRoundRect(int32_t x, int32_t y, int32_t rw, int32_t rh, int32_t r, uint32_t color) {
+    r = std::min(r, std::min(rw, rh) / 2);
+    drawFastHLine(x + r, y, rw - 2 * r, color);
+    drawFastHLine(x + r, y + rh - 1, rw - 2 * r, color);
+    drawFastVLine(x, y + r, rh - 2 * r, color);
+    drawFastVLine(x + rw - 1, y + r, rh - 2 * r, color);
+    for (int32_t i = 0; i < r; ++i) {
+        int32_t j = r - i;
+        drawPixel(x + i, y + j, color);
+        drawPixel(x + rw - 1 - i, y + j, color);
+        drawPixel(x + i, y + rh - 1 - j, color);
+        drawPixel(x + rw - 1 - i, y + rh - 1 - j, color);
+    }
+}
+
+void LovyanGFX::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color) {
+    int32_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int32_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int32_t err = dx + dy;
+    while (true) {
+        drawPixel(x0, y0, color);
+        if (x0 == x1 && y0 == y1) break;
+        int32_t e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+}
+
+void LovyanGFX::fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
+    int32_t minY = std::min({y0, y1, y2}), maxY = std::max({y0, y1, y2});
+    int32_t xs[3] = {x0, x1, x2}, ys[3] = {y0, y1, y2};
+    for (int32_t y = minY; y <= maxY; ++y) {
+        int32_t left = INT32_MAX, right = INT32_MIN;
+        for (int e = 0; e < 3; ++e) {
+            int32_t ax = xs[e], ay = ys[e], bx = xs[(e + 1) % 3], by = ys[(e + 1) % 3];
+            if ((y < ay && y < by) || (y > ay && y > by)) continue;
+            int32_t x = ay == by ? ax : ax + (bx - ax) * (y - ay) / (by - ay);
+            left = std::min(left, ay == by ? std::min(ax, bx) : x);
+            right = std::max(right, ay == by ? std::max(ax, bx) : x);
+        }
+        if (left <= right) drawFastHLine(left, y, right - left + 1, color);
+    }
+}
+
+void LovyanGFX::pushImage(int32_t x, int32_t y, int32_t iw, int32_t ih, const uint16_t *data) {
+    for (int32_t row = 0; row < ih; ++row) {
+        int32_t dy = y + row;
+        if (dy < 0 || dy >= h) continue;
+        for (int32_t col = 0; col < iw; ++col) {
+            int32_t dx = x + col;
+            if (dx >= 0 && dx < w) pixels[dy * w + dx] = data[row * iw + col];
+        }
+    }
+}
+
+void LovyanGFX::blitFrom(const LovyanGFX &src, int32_t x, int32_t y) {
+    if (!src.pixels.empty()) pushImage(x, y, src.w, src.h, src.pixels.data());
+}
+
+// Font 0 stands in for the 6x8 GLCD font; glyph bits are synthesised from
+// the character code so the per-pixel cost matches without the ROM table.
+int32_t LovyanGFX::drawGlyph(char c, int32_t x, int32_t y) {
+    uint8_t ch = (uint8_t)c;
+    if (!font) {
+        if (textBg != textFg) fillRect(x, y, 6 * textSize, 8 * textSize, textBg);
+        if (ch == ' ') return 6 * textSize;
+        for (int col = 0; col < 5; ++col) {
+            uint8_t bits = (uint8_t)((ch * 2654435761u) >> (col * 5));
+            for (int row = 0; row < 7; ++row) {
+                if (bits & (1 << row)) fillRect(x + col * textSize, y + row * textSize, textSize, textSize, textFg);
+            }
+        }
+        return 6 * textSize;
+    }
+
+    if (ch < font->first || ch > font->last) return 0;
+    const GFXglyph &g = font->glyph[ch - font->first];
+    const uint8_t *bitmap = font->bitmap + g.bitmapOffset;
+    uint8_t bits = 0, bit = 0;
+    for (int yy = 0; yy < g.height; ++yy) {
+        for (int xx = 0; xx < g.width; ++xx) {
+            if (!(bit++ & 7)) bits = *bitmap++;
+            if (bits & 0x80) drawPixel(x + g.xOffset + xx, y + g.yOffset + yy, textFg);
+            bits <<= 1;
+        }
+    }
+    return g.xAdvance;
+}
+
+int32_t LovyanGFX::textWidth(const char *s) {
+    int32_t width = 0;
+    for (; *s; ++s) {
+        uint8_t ch = (uint8_t)*s;
+        if (!font) width += 6 * textSize;
+        else if (ch >= font->first && ch <= font->last) width += font->glyph[ch - font->first].xAdvance;
+    }
+    return width;
+}
+
+size_t LovyanGFX::drawString(const char *s, int32_t x, int32_t y) {
+    int32_t width = textWidth(s);
+    int32_t height = font ? font->yAdvance : 8 * textSize;
+    int hAlign = datum % 4 == 3 ? 0 : datum % 4;
+    int vAlign = datum / 4;
+    if (hAlign == 1) x -= width / 2;
+    else if (hAlign == 2) x -= width;
+    if (vAlign == 1) y -= height / 2;
+    else if (vAlign == 2) y -= height;
+
+    // GFX fonts draw from the baseline; font 0 from the top-left corner.
+    if (font) {
+        int32_t ascent = 0;
+        for (const char *p = s; *p; ++p) {
+            uint8_t ch = (uint8_t)*p;
+            if (ch >= font->first && ch <= font->last) ascent = std::max<int32_t>(ascent, -font->glyph[ch - font->first].yOffset);
+        }
+        if (vAlign != 3) y += ascent;
+    }
+
+    for (; *s; ++s) x += drawGlyph(*s, x, y);
+    return width;
+}
+
+bool LovyanGFX::drawJpg(lgfx::DataWrapper *, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, float, float) {
+    return false;
+}
+
+static std::map<uint16_t, uint8_t> i2cRegisters;
+
+bool I2C_Class::writeRegister(uint8_t addr, uint8_t reg, const uint8_t *data, size_t len, uint32_t) {
+    for (size_t i = 0; i < len; ++i) i2cRegisters[(addr << 8) | (uint8_t)(reg + i)] = data[i];
+    return true;
+}
+
+bool I2C_Class::readRegister(uint8_t addr, uint8_t reg, uint8_t *data, size_t len, uint32_t) {
+    for (size_t i = 0; i < len; ++i) {
+        uint8_t r = reg + i;
+        auto it = i2cRegisters.find((addr << 8) | r);
+        if (it != i2cRegisters.end()) data[i] = it->second;
+        else if (r == 0xFD) data[i] = 0x83;
+        else if (r == 0xFE) data[i] = 0x11;
+        else data[i] = 0;
+    }
+    return true;
+}
@@ -0,0 +1,195 @@
+#include "SD.h"
+#include "Wire.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+fs::SDFS SD;
+SPIClass SPI;
+TwoWire Wire;
+
+static std::string sdRoot;
+
+void sdShimSetRoot(const char *hostPath) {
+    sdRoot = hostPath;
+    while (sdRoot.size() > 1 && sdRoot.back() == '/') sdRoot.pop_back();
+}
+
+const char *sdShimRoot() {
+    if (sdRoot.empty()) {
+        const char *env = getenv("SD_ROOT");
+        sdShimSetRoot(env ? env : "sdcard");
+    }
+    return sdRoot.c_str();
+}
+
+static std::string hostPath(const char *path) {
+    std::string p = path ? path : "/";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return sdShimRoot() + (p == "/" ? std::string() : p);
+}
+
+namespace fs {
+
+struct FileImpl {
+    std::string path;  // card path, e.g. /Music/a.mp3
+    std::string name;  // basename, as arduino-esp32 2.x File::name() returns
+    FILE *fp = nullptr;
+    DIR *dir = nullptr;
+    bool isDir = false;
+
+    ~FileImpl() {
+        if (fp) fclose(fp);
+        if (dir) closedir(dir);
+    }
+};
+
+static std::shared_ptr<FileImpl> openImpl(const std::string &path, const char *mode) {
+    std::string host = hostPath(path.c_str());
+    struct stat st;
+    auto impl = std::make_shared<FileImpl>();
+    impl->path = path;
+    size_t slash = path.find_last_of('/');
+    impl->name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        impl->isDir = true;
+        impl->dir = opendir(host.c_str());
+        return impl->dir ? impl : nullptr;
+    }
+
+    const char *fmode = "rb";
+    if (strcmp(mode, FILE_WRITE) == 0) fmode = "w+b";
+    else if (strcmp(mode, FILE_APPEND) == 0) fmode = "a+b";
+    impl->fp = fopen(host.c_str(), fmode);
+    return impl->fp ? impl : nullptr;
+}
+
+File::operator bool() const {
+    return impl != nullptr && (impl->fp != nullptr || impl->dir != nullptr);
+}
+
+size_t File::write(const uint8_t *buf, size_t len) {
+    return (impl && impl->fp) ? fwrite(buf, 1, len, impl->fp) : 0;
+}
+
+size_t File::read(uint8_t *buf, size_t len) {
+    return (impl && impl->fp) ? fread(buf, 1, len, impl->fp) : 0;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!impl || !impl->fp) return -1;
+    int c = fgetc(impl->fp);
+    if (c != EOF) ungetc(c, impl->fp);
+    return c == EOF ? -1 : c;
+}
+
+int File::available() {
+    return (int)(size() - position());
+}
+
+void File::flush() {
+    if (impl && impl->fp) fflush(impl->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    return impl && impl->fp && fseek(impl->fp, pos, mode) == 0;
+}
+
+size_t File::position() const {
+    return (impl && impl->fp) ? ftell(impl->fp) : 0;
+}
+
+size_t File::size() const {
+    struct stat st;
+    if (!impl || !impl->fp || fstat(fileno(impl->fp), &st) != 0) return 0;
+    return st.st_size;
+}
+
+void File::close() {
+    impl.reset();
+}
+
+const char *File::name() const {
+    return impl ? impl->name.c_str() : "";
+}
+
+const char *File::path() const {
+    return impl ? impl->path.c_str() : "";
+}
+
+bool File::isDirectory() {
+    return impl && impl->isDir;
+}
+
+time_t File::getLastWrite() {
+    struct stat st;
+    if (!impl || stat(hostPath(impl->path.c_str()).c_str(), &st) != 0) return 0;
+    return st.st_mtime;
+}
+
+File File::openNextFile(const char *mode) {
+    if (!impl || !impl->dir) return File();
+    while (struct dirent *de = readdir(impl->dir)) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        std::string child = (impl->path == "/" ? std::string() : impl->path) + "/" + de->d_name;
+        auto next = openImpl(child, mode);
+        if (next) return File(next);
+    }
+    return File();
+}
+
+void File::rewindDirectory() {
+    if (impl && impl->dir) rewinddir(impl->dir);
+}
+
+File FS::open(const char *path, const char *mode, bool) {
+    auto impl = openImpl(path, mode);
+    return impl ? File(impl) : File();
+}
+
+bool FS::exists(const char *path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) {
+    return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char *path) {
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+bool SDFS::begin(uint8_t, SPIClass &, uint32_t, const char *, uint8_t, bool) {
+    struct stat st;
+    return stat(sdShimRoot(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+} // namespace fs
+
+bool fs::SDFS::readRAW(uint8_t *buffer, uint32_t sector) {
+    uint32_t x = sector * 2654435761u + 1;
+    for (int i = 0; i < 512; ++i) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buffer[i] = (uint8_t)x;
+    }
+    return true;
+}
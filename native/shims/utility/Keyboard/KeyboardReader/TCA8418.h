@@ -0,0 +1,9 @@
+#ifndef NATIVE_TCA8418_H
+#define NATIVE_TCA8418_H
+
+#include <M5Cardputer.h>
+
+class TCA8418KeyboardReader : public KeyboardReader {
+};
+
+#endif
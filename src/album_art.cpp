@@ -0,0 +1,284 @@
+#include "album_art.h"
+#include "file_manager.h"
+#include "player_control.h"
+#include "frame_scheduler.h"
+#include "M5Cardputer.h"
+#include <atomic>
+
+constexpr size_t ART_PIXELS = ALBUM_ART_SIZE * ALBUM_ART_SIZE;
+constexpr size_t APIC_HEADER_PEEK = 160;
+constexpr uint32_t JPEG_MARKER_SCAN = 65536;
+
+struct ArtRequest {
+    uint32_t serial;
+    char path[PLAYER_PATH_MAX];
+};
+
+struct ArtFileHeader {
+    uint32_t magic;
+    uint16_t width;
+    uint16_t height;
+};
+
+// Streams one region of an open file (the APIC payload) into the JPEG
+// decoder, taking the SD mutex per read so the UI is never locked out.
+class FileRegionWrapper : public lgfx::DataWrapper {
+public:
+    FileRegionWrapper(File &file, uint32_t start, uint32_t length)
+        : file(file), start(start), length(length), pos(0) {}
+
+    int read(uint8_t *buf, uint32_t len) override {
+        if (pos >= length) return 0;
+        if (len > length - pos) len = length - pos;
+        xSemaphoreTake(sdMutex, portMAX_DELAY);
+        file.seek(start + pos);
+        int got = file.read(buf, len);
+        xSemaphoreGive(sdMutex);
+        if (got > 0) pos += got;
+        return got;
+    }
+    void skip(int32_t offset) override { pos += offset; }
+    bool seek(uint32_t offset) override {
+        pos = offset;
+        return pos <= length;
+    }
+    void close() override {}
+    int32_t tell() override { return pos; }
+
+private:
+    File &file;
+    uint32_t start;
+    uint32_t length;
+    uint32_t pos;
+};
+
+static QueueHandle_t artRequests = NULL;
+static TaskHandle_t artTask = NULL;
+// The published thumbnail and the request it answers, written by Task_Art
+// and copied out by the UI under artLock, so a cover and its request are
+// always seen together.
+static portMUX_TYPE artLock = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t artPixels[ART_PIXELS];
+static uint32_t artSerial = 0;
+static uint32_t artGeneration = 0;
+static bool artReady = false;
+static std::atomic<uint32_t> requestSerial(0);
+static uint16_t scratch[ART_PIXELS];
+
+static String cachePath(const char *path, uint32_t fileSize) {
+    uint32_t hash = 2166136261UL;
+    for (const char *p = path; *p; p++) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619UL;
+    }
+    char buf[48];
+    snprintf(buf, sizeof(buf), ALBUM_ART_DIR "/%08lx-%lx.art", (unsigned long)hash, (unsigned long)fileSize);
+    return String(buf);
+}
+
+static uint32_t readBE32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint32_t readSyncsafe(const uint8_t *p) {
+    return ((p[0] & 0x7F) << 21) | ((p[1] & 0x7F) << 14) | ((p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+// Finds the JPEG payload of the best APIC frame (front cover preferred).
+static bool findApic(File &f, uint32_t &dataStart, uint32_t &dataLength) {
+    uint8_t hdr[10];
+    if (f.read(hdr, sizeof(hdr)) != sizeof(hdr) || memcmp(hdr, "ID3", 3) != 0) return false;
+    uint8_t version = hdr[3];
+    if (version != 3 && version != 4) return false;
+    if (hdr[5] & 0x80) return false; // unsynchronised tags aren't worth handling
+
+    uint32_t tagEnd = 10 + readSyncsafe(hdr + 6);
+    uint32_t pos = 10;
+    if (hdr[5] & 0x40) {
+        uint8_t ext[4];
+        if (f.read(ext, 4) != 4) return false;
+        pos += (version == 4) ? readSyncsafe(ext) : readBE32(ext) + 4;
+    }
+
+    bool found = false;
+    while (pos + 10 <= tagEnd) {
+        uint8_t frame[10];
+        f.seek(pos);
+        if (f.read(frame, sizeof(frame)) != sizeof(frame) || frame[0] == 0) break;
+        uint32_t size = (version == 4) ? readSyncsafe(frame + 4) : readBE32(frame + 4);
+        uint32_t body = pos + 10;
+        pos = body + size;
+        if (memcmp(frame, "APIC", 4) != 0 || size < 4 || pos > tagEnd) continue;
+
+        uint8_t peek[APIC_HEADER_PEEK];
+        size_t got = f.read(peek, min((uint32_t)sizeof(peek), size));
+        uint8_t encoding = peek[0];
+        size_t i = 1;
+        while (i < got && peek[i] != 0) i++;
+        bool jpeg = strncasecmp((const char *)peek + 1, "image/jp", 8) == 0 || strncasecmp((const char *)peek + 1, "jpg", 3) == 0;
+        uint8_t pictureType = (i + 1 < got) ? peek[i + 1] : 0;
+        i += 2;
+        if (encoding == 1 || encoding == 2) {
+            while (i + 1 < got && !(peek[i] == 0 && peek[i + 1] == 0)) i += 2;
+            i += 2;
+        } else {
+            while (i < got && peek[i] != 0) i++;
+            i += 1;
+        }
+        if (!jpeg || i + 2 > got || peek[i] != 0xFF || peek[i + 1] != 0xD8) continue;
+
+        if (!found || pictureType == 3) {
+            dataStart = body + i;
+            dataLength = size - i;
+            found = true;
+            if (pictureType == 3) break;
+        }
+    }
+    return found;
+}
+
+// Reads the frame size from the SOF marker; progressive JPEGs are rejected
+// because the decoder doesn't support them.
+static bool jpegSize(FileRegionWrapper &data, uint16_t &width, uint16_t &height) {
+    uint8_t buf[9];
+    data.seek(2);
+    while ((uint32_t)data.tell() < JPEG_MARKER_SCAN) {
+        if (data.read(buf, 4) != 4 || buf[0] != 0xFF) return false;
+        uint8_t marker = buf[1];
+        uint16_t len = (buf[2] << 8) | buf[3];
+        if (marker == 0xC0 || marker == 0xC1) {
+            if (data.read(buf, 5) != 5) return false;
+            height = (buf[1] << 8) | buf[2];
+            width = (buf[3] << 8) | buf[4];
+            return width > 0 && height > 0;
+        }
+        if (marker == 0xC2 || marker == 0xDA) return false;
+        data.skip(len - 2);
+    }
+    return false;
+}
+
+static bool writeCache(const String &cacheFile, const uint16_t *pixels, uint16_t size) {
+    ArtFileHeader header = {ALBUM_ART_MAGIC, size, size};
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File out = SD.open(cacheFile, FILE_WRITE);
+    bool ok = out && out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    if (ok && size > 0) ok = out.write((const uint8_t *)pixels, ART_PIXELS * 2) == ART_PIXELS * 2;
+    if (out) out.close();
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+static bool extractArt(const ArtRequest &req, const String &cacheFile) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File f = SD.open(req.path, FILE_READ);
+    uint32_t dataStart = 0, dataLength = 0;
+    bool found = f && findApic(f, dataStart, dataLength);
+    xSemaphoreGive(sdMutex);
+
+    bool ok = false;
+    if (found) {
+        FileRegionWrapper data(f, dataStart, dataLength);
+        uint16_t width, height;
+        if (jpegSize(data, width, height)) {
+            float scale = min((float)ALBUM_ART_SIZE / width, (float)ALBUM_ART_SIZE / height);
+            int32_t offX = (ALBUM_ART_SIZE - (int32_t)(width * scale)) / 2;
+            int32_t offY = (ALBUM_ART_SIZE - (int32_t)(height * scale)) / 2;
+
+            M5Canvas canvas;
+            canvas.setColorDepth(16);
+            if (canvas.createSprite(ALBUM_ART_SIZE, ALBUM_ART_SIZE)) {
+                canvas.fillSprite(BLACK);
+                data.seek(0);
+                unsigned long start = millis();
+                ok = canvas.drawJpg(&data, offX, offY, ALBUM_ART_SIZE, ALBUM_ART_SIZE, 0, 0, scale, scale);
+                Serial.printf("[Art] %ux%u -> %d px in %lu ms\n", width, height, ALBUM_ART_SIZE, millis() - start);
+                if (ok) ok = writeCache(cacheFile, (const uint16_t *)canvas.getBuffer(), ALBUM_ART_SIZE);
+                canvas.deleteSprite();
+            }
+        }
+    }
+
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    if (f) f.close();
+    xSemaphoreGive(sdMutex);
+
+    // Remember tracks without usable art so they aren't parsed again.
+    if (!ok) writeCache(cacheFile, NULL, 0);
+    return ok;
+}
+
+// Returns true and fills `pixels` if a thumbnail is cached; a cached
+// "no art" record returns false with `cached` set.
+static bool loadCache(const String &cacheFile, uint16_t *pixels, bool &cached) {
+    ArtFileHeader header;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File in = SD.open(cacheFile, FILE_READ);
+    cached = in && in.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == ALBUM_ART_MAGIC;
+    bool ok = cached && header.width == ALBUM_ART_SIZE && header.height == ALBUM_ART_SIZE &&
+              in.read((uint8_t *)pixels, ART_PIXELS * 2) == ART_PIXELS * 2;
+    if (in) in.close();
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+static void publish(uint32_t serial, const uint16_t *pixels) {
+    portENTER_CRITICAL(&artLock);
+    if (pixels) memcpy(artPixels, pixels, sizeof(artPixels));
+    artSerial = serial;
+    artReady = pixels != NULL;
+    artGeneration++;
+    portEXIT_CRITICAL(&artLock);
+    requestRedraw(REDRAW_STATE);
+}
+
+static void Task_Art(void *) {
+    ArtRequest req;
+    while (true) {
+        if (xQueueReceive(artRequests, &req, portMAX_DELAY) != pdTRUE) continue;
+
+        xSemaphoreTake(sdMutex, portMAX_DELAY);
+        File f = SD.open(req.path, FILE_READ);
+        uint32_t fileSize = f ? f.size() : 0;
+        if (f) f.close();
+        xSemaphoreGive(sdMutex);
+        if (fileSize == 0) {
+            publish(req.serial, NULL);
+            continue;
+        }
+
+        String cacheFile = cachePath(req.path, fileSize);
+        bool cached = false;
+        bool ok = loadCache(cacheFile, scratch, cached);
+        if (!cached && extractArt(req, cacheFile)) ok = loadCache(cacheFile, scratch, cached);
+        publish(req.serial, ok ? scratch : NULL);
+    }
+}
+
+void initAlbumArt() {
+    if (!SD.exists(ALBUM_ART_DIR)) SD.mkdir(ALBUM_ART_DIR);
+    artRequests = xQueueCreate(1, sizeof(ArtRequest));
+    // Lowest app priority on the UI core: decoding only uses cycles that
+    // neither the UI nor the audio task (core 1) wants.
+    xTaskCreatePinnedToCore(Task_Art, "Task_Art", 8192, NULL, 1, &artTask, 0);
+}
+
+uint32_t requestAlbumArt(const String &path) {
+    if (artRequests == NULL) return 0;
+    ArtRequest req;
+    req.serial = ++requestSerial;
+    strlcpy(req.path, path.c_str(), sizeof(req.path));
+    xQueueOverwrite(artRequests, &req);
+    return req.serial;
+}
+
+bool albumArtFor(uint32_t request, uint16_t *pixels, uint32_t &generation) {
+    portENTER_CRITICAL(&artLock);
+    bool ok = artReady && artSerial == request;
+    if (ok && generation != artGeneration) {
+        memcpy(pixels, artPixels, sizeof(artPixels));
+        generation = artGeneration;
+    }
+    portEXIT_CRITICAL(&artLock);
+    return ok;
+}
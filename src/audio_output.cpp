@@ -0,0 +1,342 @@
+#include "audio_output.h"
+#include "audio_config.h"
+#include "es8311.h"
+#include "profiler.h"
+
+static bool outputReady = false;
+static volatile uint32_t framesWritten = 0;
+static volatile uint32_t blockedUs = 0;
+static uint32_t currentRate = AUDIO_OUTPUT_DEFAULT_RATE;
+
+static QueueHandle_t i2sEvents = NULL;
+static int dmaCount = AUDIO_OUTPUT_DMA_COUNT;
+static int dmaLen = AUDIO_OUTPUT_DMA_LEN;
+static int32_t queuedFrames = 0;
+static bool streaming = false;
+static bool adaptive = true;
+static uint32_t underruns = 0;
+static uint32_t reconfigs = 0;
+static unsigned long lastUnderrunMs = 0;
+
+enum OutputState : uint8_t {
+    OUTPUT_RUNNING,
+    OUTPUT_FADING_OUT,
+    OUTPUT_PAUSED
+};
+
+constexpr int32_t GAIN_UNITY = 32768;
+constexpr size_t RAMP_CHUNK_FRAMES = 128;
+
+static OutputState outputState = OUTPUT_RUNNING;
+static int32_t gainQ15 = GAIN_UNITY;
+static uint32_t pauseOriginUs = 0;
+static int16_t *holdover = NULL;
+static size_t holdCapacity = 0;
+static size_t holdoverFrames = 0;
+static uint32_t holdRejected = 0;
+
+static bool installDriver(int count, int len) {
+    i2s_config_t cfg = {};
+    cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX);
+    cfg.sample_rate = currentRate;
+    cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    cfg.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+    cfg.communication_format = (i2s_comm_format_t)I2S_COMM_FORMAT_STAND_I2S;
+    cfg.intr_alloc_flags = 0;
+    cfg.dma_buf_count = count;
+    cfg.dma_buf_len = len;
+    cfg.use_apll = false;
+    cfg.tx_desc_auto_clear = true;
+    cfg.fixed_mclk = 0;
+
+    // One TX_DONE event per DMA buffer consumed; sized so a full ring of
+    // completions fits between two writes.
+    if (i2s_driver_install(AUDIO_OUTPUT_PORT, &cfg, AUDIO_OUTPUT_DMA_MAX_COUNT * 2, &i2sEvents) != ESP_OK) {
+        Serial.println("ERROR: audio output i2s_driver_install failed");
+        return false;
+    }
+
+    i2s_pin_config_t pins = {
+        .mck_io_num = I2S_PIN_NO_CHANGE,
+        .bck_io_num = CARDPUTER_I2S_BCLK,
+        .ws_io_num = CARDPUTER_I2S_LRCK,
+        .data_out_num = CARDPUTER_I2S_DOUT,
+        .data_in_num = I2S_PIN_NO_CHANGE
+    };
+
+    if (i2s_set_pin(AUDIO_OUTPUT_PORT, &pins) != ESP_OK) {
+        Serial.println("ERROR: audio output i2s_set_pin failed");
+        i2s_driver_uninstall(AUDIO_OUTPUT_PORT);
+        return false;
+    }
+
+    i2s_zero_dma_buffer(AUDIO_OUTPUT_PORT);
+    dmaCount = count;
+    dmaLen = len;
+    queuedFrames = 0;
+    return true;
+}
+
+bool initAudioOutput() {
+    outputReady = audioOutputReserveHold(AUDIO_OUTPUT_HOLD_FRAMES) && installDriver(dmaCount, dmaLen);
+    return outputReady;
+}
+
+// Grows only; held frames survive the move.
+bool audioOutputReserveHold(size_t frames) {
+    if (frames <= holdCapacity) return true;
+    int16_t *grown = (int16_t *)realloc(holdover, frames * 2 * sizeof(int16_t));
+    if (grown == NULL) {
+        Serial.printf("ERROR: cannot grow pause hold to %u frames\n", (unsigned)frames);
+        return false;
+    }
+    holdover = grown;
+    holdCapacity = frames;
+    return true;
+}
+
+// The legacy driver can't resize its DMA ring in place, so a geometry change
+// is a reinstall. Callers only do this while the ring is empty anyway (idle,
+// or right after an underrun), so nothing audible is dropped.
+bool audioOutputConfigure(int count, int len) {
+    count = constrain(count, AUDIO_OUTPUT_DMA_MIN_COUNT, AUDIO_OUTPUT_DMA_MAX_COUNT);
+    if (outputReady && count == dmaCount && len == dmaLen) return true;
+
+    uint32_t start = micros();
+    if (outputReady) i2s_driver_uninstall(AUDIO_OUTPUT_PORT);
+    outputReady = installDriver(count, len);
+    if (!outputReady) return false;
+
+    reconfigs++;
+    Serial.printf("[AudioOut] DMA %dx%d (%lu ms) in %luus\n", count, len,
+                  (unsigned long)((uint64_t)count * len * 1000 / currentRate), micros() - start);
+    return true;
+}
+
+void audioOutputSetAdaptive(bool enabled) {
+    adaptive = enabled;
+}
+
+static void drainEvents() {
+    i2s_event_t evt;
+    while (i2sEvents != NULL && xQueueReceive(i2sEvents, &evt, 0) == pdTRUE) {
+        if (evt.type != I2S_EVENT_TX_DONE) continue;
+        queuedFrames -= dmaLen;
+        if (queuedFrames <= 0) {
+            if (streaming) {
+                underruns++;
+                lastUnderrunMs = millis();
+                streaming = false;
+            }
+            queuedFrames = 0;
+        }
+    }
+}
+
+// Called by the audio task whenever playback pauses, stops or ends, so the
+// resulting drain isn't counted as an underrun. Pending shrinks happen here.
+void audioOutputIdle() {
+    drainEvents();
+    streaming = false;
+
+    if (adaptive && outputState == OUTPUT_RUNNING && dmaCount > AUDIO_OUTPUT_DMA_MIN_COUNT &&
+        millis() - lastUnderrunMs >= AUDIO_OUTPUT_SHRINK_AFTER_MS) {
+        audioOutputConfigure(dmaCount - AUDIO_OUTPUT_DMA_SHRINK_STEP, dmaLen);
+        lastUnderrunMs = millis();
+    }
+}
+
+static size_t writeFrames(const int16_t *frames, size_t frameCount) {
+    size_t bytesWritten = 0;
+    uint32_t start = micros();
+    i2s_write(AUDIO_OUTPUT_PORT, frames, frameCount * 2 * sizeof(int16_t), &bytesWritten, portMAX_DELAY);
+    blockedUs += micros() - start;
+
+    size_t written = bytesWritten / (2 * sizeof(int16_t));
+    framesWritten += written;
+    queuedFrames += written;
+    streaming = true;
+    return written;
+}
+
+static int32_t rampStep() {
+    int32_t frames = currentRate * AUDIO_OUTPUT_FADE_MS / 1000;
+    return GAIN_UNITY / (frames > 0 ? frames : 1);
+}
+
+// Anything that doesn't fit is refused, not dropped: the short count goes
+// back to the caller, which keeps it.
+static size_t holdFrames(const int16_t *frames, size_t frameCount) {
+    size_t room = holdCapacity - holdoverFrames;
+    if (frameCount > room) {
+        holdRejected += frameCount - room;
+        frameCount = room;
+    }
+    memcpy(&holdover[holdoverFrames * 2], frames, frameCount * 2 * sizeof(int16_t));
+    holdoverFrames += frameCount;
+    return frameCount;
+}
+
+// Waits for the ring to play out, then stops the I2S clock so neither the
+// DMA interrupt nor the decoder wakes anything while paused.
+static void enterPaused() {
+    i2s_event_t evt;
+    uint32_t timeoutMs = (uint64_t)dmaCount * dmaLen * 1000 / currentRate + 10;
+    while (queuedFrames > 0 && xQueueReceive(i2sEvents, &evt, pdMS_TO_TICKS(timeoutMs)) == pdTRUE) {
+        if (evt.type == I2S_EVENT_TX_DONE) queuedFrames -= dmaLen;
+    }
+    queuedFrames = 0;
+    streaming = false;
+    i2s_stop(AUDIO_OUTPUT_PORT);
+    i2s_zero_dma_buffer(AUDIO_OUTPUT_PORT);
+    outputState = OUTPUT_PAUSED;
+    gainQ15 = 0;
+
+    if (pauseOriginUs != 0) {
+        uint32_t us = micros() - pauseOriginUs;
+        profilerLatency(PROF_LAT_KEY_TO_SILENCE, us);
+        Serial.printf("[AudioOut] Paused, key-to-silence %luus, %u frames held\n", (unsigned long)us,
+                      (unsigned)holdoverFrames);
+    }
+}
+
+// Applies the current ramp to the frames and writes them. Fade-out stops at
+// silence; whatever is left is held for resume.
+static size_t writeRamped(const int16_t *frames, size_t frameCount) {
+    int16_t scratch[RAMP_CHUNK_FRAMES * 2];
+    int32_t step = rampStep();
+    size_t done = 0;
+
+    while (done < frameCount) {
+        if (outputState == OUTPUT_RUNNING && gainQ15 >= GAIN_UNITY) {
+            return done + writeFrames(frames + done * 2, frameCount - done);
+        }
+        if (outputState == OUTPUT_FADING_OUT && gainQ15 <= 0) {
+            done += holdFrames(frames + done * 2, frameCount - done);
+            enterPaused();
+            return done;
+        }
+
+        size_t n = min(frameCount - done, RAMP_CHUNK_FRAMES);
+        int32_t delta = (outputState == OUTPUT_FADING_OUT) ? -step : step;
+        size_t i = 0;
+        for (; i < n; i++) {
+            gainQ15 += delta;
+            if (gainQ15 <= 0 || gainQ15 >= GAIN_UNITY) {
+                gainQ15 = constrain(gainQ15, 0, GAIN_UNITY);
+                scratch[2 * i] = (frames[(done + i) * 2] * gainQ15) >> 15;
+                scratch[2 * i + 1] = (frames[(done + i) * 2 + 1] * gainQ15) >> 15;
+                i++;
+                break;
+            }
+            scratch[2 * i] = (frames[(done + i) * 2] * gainQ15) >> 15;
+            scratch[2 * i + 1] = (frames[(done + i) * 2 + 1] * gainQ15) >> 15;
+        }
+        writeFrames(scratch, i);
+        done += i;
+    }
+    return done;
+}
+
+size_t audioOutputWrite(const int16_t *frames, size_t frameCount) {
+    if (!outputReady || frameCount == 0) return 0;
+
+    if (outputState == OUTPUT_PAUSED) return holdFrames(frames, frameCount);
+
+    uint32_t before = underruns;
+    drainEvents();
+    if (adaptive && underruns != before && dmaCount < AUDIO_OUTPUT_DMA_MAX_COUNT) {
+        audioOutputConfigure(dmaCount + AUDIO_OUTPUT_DMA_GROW_STEP, dmaLen);
+    }
+
+    return writeRamped(frames, frameCount);
+}
+
+void audioOutputPause(uint32_t originUs) {
+    if (!outputReady || outputState != OUTPUT_RUNNING) return;
+    pauseOriginUs = originUs;
+    outputState = OUTPUT_FADING_OUT;
+}
+
+// Used when the decoder has nothing to fade (input starved or at EOF).
+void audioOutputForcePause() {
+    if (!outputReady || outputState == OUTPUT_PAUSED) return;
+    enterPaused();
+}
+
+bool audioOutputPaused() {
+    return outputState == OUTPUT_PAUSED;
+}
+
+void audioOutputResume() {
+    if (!outputReady) return;
+    if (outputState == OUTPUT_PAUSED) {
+        drainEvents();
+        queuedFrames = 0;
+        i2s_start(AUDIO_OUTPUT_PORT);
+    }
+    outputState = OUTPUT_RUNNING;
+
+    if (holdoverFrames > 0) {
+        size_t frames = holdoverFrames;
+        holdoverFrames = 0;
+        writeRamped(holdover, frames);
+    }
+}
+
+// Drops any pause state and held audio, e.g. on stop or a new track.
+void audioOutputReset() {
+    if (!outputReady) return;
+    if (outputState == OUTPUT_PAUSED) i2s_start(AUDIO_OUTPUT_PORT);
+    outputState = OUTPUT_RUNNING;
+    gainQ15 = GAIN_UNITY;
+    holdoverFrames = 0;
+}
+
+uint32_t audioOutputFramesWritten() {
+    return framesWritten;
+}
+
+// Audio task only, like every other call that drains the event queue.
+uint32_t audioOutputPendingFrames() {
+    drainEvents();
+    return queuedFrames + holdoverFrames;
+}
+
+uint32_t audioOutputBlockedUs() {
+    return blockedUs;
+}
+
+// Fast path for a rate change: reprogram the I2S clock dividers in place
+// (the driver stays installed) and retune the codec's MCLK multiplier.
+bool audioOutputSetSampleRate(uint32_t sampleRate) {
+    if (!outputReady || sampleRate == 0) return false;
+    if (sampleRate == currentRate) return true;
+
+    uint32_t start = micros();
+    if (i2s_set_clk(AUDIO_OUTPUT_PORT, sampleRate, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_STEREO) != ESP_OK) {
+        Serial.printf("ERROR: i2s_set_clk %lu Hz failed\n", (unsigned long)sampleRate);
+        return false;
+    }
+    es8311SetSampleRate(sampleRate, 32);
+    currentRate = sampleRate;
+    Serial.printf("[AudioOut] Reclocked to %lu Hz in %luus\n", (unsigned long)sampleRate, micros() - start);
+    return true;
+}
+
+uint32_t audioOutputSampleRate() {
+    return currentRate;
+}
+
+AudioOutputStats getAudioOutputStats() {
+    AudioOutputStats s;
+    s.dmaCount = dmaCount;
+    s.dmaLen = dmaLen;
+    s.sampleRate = currentRate;
+    s.underruns = underruns;
+    s.reconfigs = reconfigs;
+    s.latencyUs = (uint64_t)queuedFrames * 1000000 / currentRate;
+    s.capacityUs = (uint64_t)dmaCount * dmaLen * 1000000 / currentRate;
+    s.holdRejected = holdRejected;
+    return s;
+}
@@ -0,0 +1,154 @@
+#include "decode_bench.h"
+#include "audio_config.h"
+#include "file_manager.h"
+#include "decode_cost.h"
+#include "esp_heap_caps.h"
+#include <algorithm>
+
+constexpr uint8_t DECODE_BENCH_MAX_FILES = 32;
+
+static bool active = false;
+static uint32_t runs = 0;
+static uint32_t lastReturnUs = 0;
+static bool gapValid = false;
+static uint32_t callbacks = 0;
+static uint64_t decodedFrames = 0;
+static uint64_t frameUsSum = 0;
+static uint32_t peakFrameUs = 0;
+static size_t minHeapFree = 0;
+
+bool decodeBenchActive() {
+    return active;
+}
+
+uint32_t decodeBenchRuns() {
+    return runs;
+}
+
+// Called from audio_process_i2s for every decoded chunk. The time since the
+// previous chunk was handed over is what the decoder spent producing this one.
+void decodeBenchOnFrame(uint16_t validSamples) {
+    uint32_t now = micros();
+    if (gapValid) {
+        uint32_t us = now - lastReturnUs;
+        frameUsSum += us;
+        if (us > peakFrameUs) peakFrameUs = us;
+    }
+    size_t heapFree = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    if (heapFree < minHeapFree) minHeapFree = heapFree;
+    callbacks++;
+    decodedFrames += validSamples;
+    gapValid = true;
+    lastReturnUs = micros();
+}
+
+static uint8_t listFiles(const String &folder, String *files) {
+    uint8_t count = 0;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File dir = SD.open(folder);
+    if (dir && dir.isDirectory()) {
+        File entry;
+        while (count < DECODE_BENCH_MAX_FILES && (entry = dir.openNextFile())) {
+            String name = entry.name();
+            if (!entry.isDirectory() && isAudioFile(name)) {
+                int slash = name.lastIndexOf('/');
+                files[count++] = folder + "/" + name.substring(slash + 1);
+            }
+            entry.close();
+        }
+    }
+    if (dir) dir.close();
+    xSemaphoreGive(sdMutex);
+    std::sort(files, files + count, [](const String &a, const String &b) { return a.compareTo(b) < 0; });
+    return count;
+}
+
+static bool benchFile(const String &path, DecodeBenchResult &r) {
+    memset(&r, 0, sizeof(r));
+    callbacks = 0;
+    decodedFrames = 0;
+    frameUsSum = 0;
+    peakFrameUs = 0;
+    gapValid = false;
+    size_t heapBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    minHeapFree = heapBefore;
+
+    active = true;
+    uint32_t start = micros();
+    bool ok = audio.connecttoFS(SD, path.c_str());
+    r.connectUs = micros() - start;
+
+    // Decode flat out, but give the scheduler a tick now and then; the
+    // yield is not counted as decode time.
+    uint64_t wallUs = 0;
+    uint32_t sliceStart = micros();
+    while (ok && audio.isRunning()) {
+        audio.loop();
+        uint32_t sliceUs = micros() - sliceStart;
+        if (sliceUs >= DECODE_BENCH_SLICE_US) {
+            wallUs += sliceUs;
+            if (wallUs >= DECODE_BENCH_TIMEOUT_MS * 1000ULL) {
+                Serial.printf("[Bench] %s: timed out\n", path.c_str());
+                ok = false;
+                break;
+            }
+            vTaskDelay(1);
+            gapValid = false;
+            sliceStart = micros();
+        }
+    }
+    wallUs += micros() - sliceStart;
+    r.sampleRate = audio.getSampleRate();
+    r.bitRate = audio.getBitRate();
+    r.channels = audio.getChannels();
+    audio.stopSong();
+    active = false;
+
+    if (!ok || decodedFrames == 0 || r.sampleRate == 0) return false;
+    r.frames = callbacks;
+    r.audioMs = (uint32_t)(decodedFrames * 1000ULL / r.sampleRate);
+    r.wallMs = (uint32_t)(wallUs / 1000ULL);
+    r.rtfX1000 = r.audioMs ? (uint32_t)(wallUs / r.audioMs) : 0;
+    r.avgFrameUs = callbacks > 1 ? (uint32_t)(frameUsSum / (callbacks - 1)) : 0;
+    r.peakFrameUs = peakFrameUs;
+    r.heapPeak = heapBefore - minHeapFree;
+    return true;
+}
+
+uint32_t runDecodeBenchmark(const String &folder) {
+    static String files[DECODE_BENCH_MAX_FILES];
+    uint8_t count = listFiles(folder, files);
+    Serial.printf("[Bench] decoding %u files from %s\n", count, folder.c_str());
+
+    uint32_t passed = 0;
+    uint32_t worstRtf = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        DecodeBenchResult r;
+        const char *name = files[i].c_str() + files[i].lastIndexOf('/') + 1;
+        if (!benchFile(files[i], r)) {
+            Serial.printf("[Bench] %s: FAILED\n", name);
+            Serial.printf("$DEC,%s,0,0,0,0,0,0,0,0,0,0\n", name);
+            continue;
+        }
+        Serial.printf("[Bench] %-32s %5lu Hz %uch %3lu kbps  rtf=%lu.%03lu  frame avg=%luus peak=%luus  heap+%lu\n",
+                      name, (unsigned long)r.sampleRate, r.channels, (unsigned long)(r.bitRate / 1000),
+                      (unsigned long)(r.rtfX1000 / 1000), (unsigned long)(r.rtfX1000 % 1000),
+                      (unsigned long)r.avgFrameUs, (unsigned long)r.peakFrameUs, (unsigned long)r.heapPeak);
+        Serial.printf("$DEC,%s,%lu,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                      name, (unsigned long)r.sampleRate, r.channels, (unsigned long)r.bitRate,
+                      (unsigned long)r.audioMs, (unsigned long)r.wallMs, (unsigned long)r.rtfX1000,
+                      (unsigned long)r.avgFrameUs, (unsigned long)r.peakFrameUs, (unsigned long)r.heapPeak,
+                      (unsigned long)r.connectUs);
+        if (r.rtfX1000 > worstRtf) worstRtf = r.rtfX1000;
+        passed++;
+
+        TrackFormat fmt;
+        if (probeTrackFormat(files[i].c_str(), fmt)) recordDecodeCost(fmt, r.rtfX1000, r.heapPeak);
+    }
+
+    Serial.printf("[Bench] done: %lu/%u files, worst rtf=%lu.%03lu\n",
+                  (unsigned long)passed, count, (unsigned long)(worstRtf / 1000), (unsigned long)(worstRtf % 1000));
+    printDecodeCosts();
+    runs++;
+    return passed;
+}
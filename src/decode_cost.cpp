@@ -0,0 +1,153 @@
+#include "decode_cost.h"
+#include <Preferences.h>
+
+constexpr uint16_t COST_VERSION = 1;
+
+struct CostEntry {
+    uint32_t sampleRate;
+    uint32_t heapBytes;
+    uint16_t cpuPermille;
+    uint8_t codec;
+    uint8_t bitsPerSample;
+    uint8_t channels;
+    uint8_t reserved[3];
+};
+
+struct StoredCosts {
+    uint16_t version;
+    uint16_t count;
+    CostEntry entries[DECODE_COST_SLOTS];
+};
+
+// Model used until the benchmark has run on this device: core share per
+// 100k samples/s (rate x channels), scaled up for samples wider than
+// 16 bits, plus a fixed heap and a per-block-frame term for FLAC's buffers.
+struct CostModel {
+    uint16_t permillePer100k;
+    uint32_t heapBase;
+    uint8_t heapPerBlockFrame; // bytes per frame per channel
+};
+
+static const CostModel kModels[] = {
+    {280, 28 * 1024, 0}, // CODEC_MP3
+    {30, 4 * 1024, 0},   // CODEC_WAV
+    {260, 8 * 1024, 4},  // CODEC_FLAC
+};
+
+static const char *const kCodecNames[] = {"mp3", "wav", "flac"};
+
+static StoredCosts costs = {};
+static SemaphoreHandle_t costMutex = NULL;
+
+static uint32_t samplesPerSec(uint32_t rate, uint8_t channels, uint8_t bits) {
+    uint32_t sps = rate * channels;
+    return bits > 16 ? sps + sps / 2 : sps;
+}
+
+static uint32_t distance(uint32_t a, uint32_t b) {
+    return a > b ? a - b : b - a;
+}
+
+void initDecodeCosts() {
+    if (costMutex == NULL) costMutex = xSemaphoreCreateMutex();
+    Preferences prefs;
+    if (!prefs.begin("decost", true)) return;
+    if (prefs.getBytes("table", &costs, sizeof(costs)) != sizeof(costs) || costs.version != COST_VERSION ||
+        costs.count > DECODE_COST_SLOTS) {
+        memset(&costs, 0, sizeof(costs));
+    }
+    prefs.end();
+    Serial.printf("[Cost] %u measured formats\n", costs.count);
+}
+
+DecodeCost estimateDecodeCost(const TrackFormat &fmt) {
+    const CostModel &model = kModels[fmt.codec < CODEC_FLAC ? fmt.codec : CODEC_FLAC];
+    uint32_t sps = samplesPerSec(fmt.sampleRate, fmt.channels, fmt.bitsPerSample);
+    DecodeCost cost;
+    cost.cpuPermille = (uint64_t)model.permillePer100k * sps / 100000;
+    cost.heapBytes = model.heapBase + fmt.blockFrames * fmt.channels * model.heapPerBlockFrame;
+    cost.measured = false;
+
+    xSemaphoreTake(costMutex, portMAX_DELAY);
+    const CostEntry *nearest = NULL;
+    uint32_t nearestSps = 0;
+    for (uint16_t i = 0; i < costs.count; i++) {
+        const CostEntry &e = costs.entries[i];
+        if (e.codec != fmt.codec) continue;
+        uint32_t esps = samplesPerSec(e.sampleRate, e.channels, e.bitsPerSample);
+        if (nearest == NULL || distance(esps, sps) < distance(nearestSps, sps)) {
+            nearest = &e;
+            nearestSps = esps;
+        }
+    }
+    if (nearest != NULL && nearestSps > 0) {
+        cost.measured = nearestSps == sps && nearest->sampleRate == fmt.sampleRate;
+        cost.cpuPermille = (uint64_t)nearest->cpuPermille * sps / nearestSps;
+        if (cost.measured || nearest->heapBytes > cost.heapBytes) cost.heapBytes = nearest->heapBytes;
+    }
+    xSemaphoreGive(costMutex);
+    return cost;
+}
+
+DecodeVerdict checkDecodeBudget(const TrackFormat &fmt, DecodeCost &cost) {
+    cost = estimateDecodeCost(fmt);
+    if (cost.cpuPermille > DECODE_CPU_BUDGET_PERMILLE || cost.heapBytes > DECODE_HEAP_BUDGET) return DECODE_REFUSE;
+    return cost.cpuPermille > DECODE_CPU_WARN_PERMILLE ? DECODE_WARN : DECODE_OK;
+}
+
+void recordDecodeCost(const TrackFormat &fmt, uint32_t rtfX1000, uint32_t heapBytes) {
+    xSemaphoreTake(costMutex, portMAX_DELAY);
+    CostEntry *slot = NULL;
+    for (uint16_t i = 0; i < costs.count && slot == NULL; i++) {
+        CostEntry &e = costs.entries[i];
+        if (e.codec == fmt.codec && e.sampleRate == fmt.sampleRate && e.channels == fmt.channels &&
+            e.bitsPerSample == fmt.bitsPerSample) {
+            slot = &e;
+        }
+    }
+    if (slot == NULL) {
+        // Full table: the newest measurement replaces the oldest.
+        if (costs.count == DECODE_COST_SLOTS) {
+            memmove(&costs.entries[0], &costs.entries[1], sizeof(CostEntry) * (DECODE_COST_SLOTS - 1));
+            costs.count--;
+        }
+        slot = &costs.entries[costs.count++];
+        memset(slot, 0, sizeof(*slot));
+        slot->codec = fmt.codec;
+        slot->sampleRate = fmt.sampleRate;
+        slot->channels = fmt.channels;
+        slot->bitsPerSample = fmt.bitsPerSample;
+    } else {
+        // Several files of one format: keep the worst.
+        if (rtfX1000 < slot->cpuPermille) rtfX1000 = slot->cpuPermille;
+        if (heapBytes < slot->heapBytes) heapBytes = slot->heapBytes;
+    }
+    slot->cpuPermille = min<uint32_t>(rtfX1000, UINT16_MAX);
+    slot->heapBytes = heapBytes;
+    costs.version = COST_VERSION;
+    StoredCosts snapshot = costs;
+    xSemaphoreGive(costMutex);
+
+    Preferences prefs;
+    if (prefs.begin("decost", false)) {
+        prefs.putBytes("table", &snapshot, sizeof(snapshot));
+        prefs.end();
+    }
+}
+
+void printDecodeCosts() {
+    xSemaphoreTake(costMutex, portMAX_DELAY);
+    StoredCosts snapshot = costs;
+    xSemaphoreGive(costMutex);
+
+    Serial.printf("[Cost] budget %u.%u%% of core 1, %lu KB heap\n", DECODE_CPU_BUDGET_PERMILLE / 10,
+                  DECODE_CPU_BUDGET_PERMILLE % 10, (unsigned long)(DECODE_HEAP_BUDGET / 1024));
+    for (uint16_t i = 0; i < snapshot.count; i++) {
+        const CostEntry &e = snapshot.entries[i];
+        Serial.printf("[Cost] %-4s %6lu Hz %2u bit %uch  %3u.%u%%  %lu B\n", kCodecNames[e.codec],
+                      (unsigned long)e.sampleRate, e.bitsPerSample, e.channels,
+                      e.cpuPermille / 10, e.cpuPermille % 10, (unsigned long)e.heapBytes);
+        Serial.printf("$COST,%s,%lu,%u,%u,%u,%lu\n", kCodecNames[e.codec], (unsigned long)e.sampleRate,
+                      e.bitsPerSample, e.channels, e.cpuPermille, (unsigned long)e.heapBytes);
+    }
+}
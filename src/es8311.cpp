@@ -0,0 +1,163 @@
+#include "es8311.h"
+#include "audio_config.h"
+#include "M5Cardputer.h"
+
+constexpr uint8_t ES8311_CHIP_ID1 = 0x83;
+constexpr uint8_t ES8311_CHIP_ID2 = 0x11;
+// The codec has no power-up status bit to poll, and reading 0x0D back only
+// returns what was written. Give the analog supplies a fixed settle after
+// power-up: the 2 ms the original per-register init spacing provided.
+constexpr uint32_t ES8311_POWER_UP_SETTLE_MS = 2;
+
+struct RegisterBlock {
+    uint8_t reg;
+    uint8_t len;
+    uint8_t values[4];
+};
+
+// Contiguous runs are sent as one auto-increment transaction each.
+static constexpr RegisterBlock kInitBlocks[] = {
+    {ES8311_REG_RESET, 3, {0x80, 0xB5, 0x18}},
+    {ES8311_REG_SYSTEM_0D, 1, {0x01}},
+    {ES8311_REG_SYSTEM_12, 2, {0x00, 0x10}},
+    {ES8311_REG_DAC_VOLUME, 1, {0xBF}},
+    {ES8311_REG_DAC_37, 1, {0x08}},
+};
+
+static uint8_t shadow[ES8311_REG_COUNT];
+static bool shadowValid[ES8311_REG_COUNT];
+static Es8311Stats stats = {};
+
+static void updateShadow(uint8_t reg, const uint8_t *values, size_t len) {
+    for (size_t i = 0; i < len && reg + i < ES8311_REG_COUNT; i++) {
+        shadow[reg + i] = values[i];
+        shadowValid[reg + i] = true;
+    }
+}
+
+bool es8311WriteBlock(uint8_t reg, const uint8_t *values, size_t len) {
+    stats.transactions++;
+    if (!M5.In_I2C.writeRegister(ES8311_ADDR, reg, values, len, ES8311_I2C_FREQ)) {
+        Serial.printf("ES8311 I2C write failed reg 0x%02X len %u\n", reg, (unsigned)len);
+        return false;
+    }
+    stats.bytesWritten += len;
+    updateShadow(reg, values, len);
+    return true;
+}
+
+bool es8311Update(uint8_t reg, uint8_t value) {
+    if (reg < ES8311_REG_COUNT && shadowValid[reg] && shadow[reg] == value) {
+        stats.skippedWrites++;
+        return true;
+    }
+    return es8311WriteBlock(reg, &value, 1);
+}
+
+bool es8311Verify(uint8_t reg, size_t len) {
+    uint8_t readback[8];
+    if (len > sizeof(readback)) len = sizeof(readback);
+
+    stats.transactions++;
+    if (!M5.In_I2C.readRegister(ES8311_ADDR, reg, readback, len, ES8311_I2C_FREQ)) {
+        stats.verifyFailures++;
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (reg + i < ES8311_REG_COUNT && shadowValid[reg + i] && readback[i] != shadow[reg + i]) {
+            Serial.printf("ES8311 verify reg 0x%02X: wrote 0x%02X read 0x%02X\n",
+                          (unsigned)(reg + i), shadow[reg + i], readback[i]);
+            stats.verifyFailures++;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeVerified(const RegisterBlock &block) {
+    if (es8311WriteBlock(block.reg, block.values, block.len) && es8311Verify(block.reg, block.len)) {
+        return true;
+    }
+
+    // Fall back to one register per transaction if the burst didn't land.
+    bool ok = true;
+    for (uint8_t i = 0; i < block.len; i++) {
+        ok &= es8311WriteBlock(block.reg + i, &block.values[i], 1);
+    }
+    return ok && es8311Verify(block.reg, block.len);
+}
+
+bool es8311Begin() {
+    uint32_t start = micros();
+    memset(shadowValid, 0, sizeof(shadowValid));
+
+    uint8_t id[2];
+    if (!M5.In_I2C.readRegister(ES8311_ADDR, ES8311_REG_CHIP_ID1, id, 2, ES8311_I2C_FREQ)) {
+        Serial.println("ES8311 not responding on I2C");
+        return false;
+    }
+    if (id[0] != ES8311_CHIP_ID1 || id[1] != ES8311_CHIP_ID2) {
+        Serial.printf("ES8311 unexpected chip id %02X%02X\n", id[0], id[1]);
+    }
+
+    bool ok = true;
+    for (const auto &block : kInitBlocks) {
+        ok &= writeVerified(block);
+        // The only settling point in the sequence, before the DAC path is enabled.
+        if (block.reg == ES8311_REG_SYSTEM_0D) delay(ES8311_POWER_UP_SETTLE_MS);
+    }
+
+    stats.lastConfigUs = micros() - start;
+    Serial.printf("ES8311 init %s in %luus (%lu transactions)\n", ok ? "ok" : "FAILED",
+                  (unsigned long)stats.lastConfigUs, (unsigned long)stats.transactions);
+    return ok;
+}
+
+bool es8311SetSampleRate(uint32_t sampleRate, uint8_t bitsPerFrame) {
+    // MCLK is taken from BCLK; pre_multi brings it up to 256 * fs.
+    uint8_t multi;
+    switch (bitsPerFrame) {
+    case 32: multi = 3; break;  // x8
+    case 64: multi = 2; break;  // x4
+    case 128: multi = 1; break; // x2
+    default:
+        Serial.printf("ES8311 unsupported frame size %u bits\n", bitsPerFrame);
+        return false;
+    }
+
+    uint32_t start = micros();
+    uint8_t reg02 = (shadow[ES8311_REG_CLK_MANAGER2] & ~0x18) | (multi << 3);
+    bool ok = es8311Update(ES8311_REG_CLK_MANAGER2, reg02);
+    stats.lastConfigUs = micros() - start;
+    Serial.printf("ES8311 clock %lu Hz, %u bclk/frame (%luus)\n", (unsigned long)sampleRate, bitsPerFrame,
+                  (unsigned long)stats.lastConfigUs);
+    return ok;
+}
+
+bool es8311SetPower(Es8311Power state) {
+    uint32_t start = micros();
+    bool ok;
+    if (state == ES8311_POWER_ON) {
+        bool wasDown = !shadowValid[ES8311_REG_SYSTEM_0D] || shadow[ES8311_REG_SYSTEM_0D] != 0x01;
+        ok = es8311Update(ES8311_REG_SYSTEM_0D, 0x01);
+        if (ok && wasDown) delay(ES8311_POWER_UP_SETTLE_MS);
+        ok = ok && es8311Update(ES8311_REG_SYSTEM_12, 0x00);
+    } else {
+        ok = es8311Update(ES8311_REG_SYSTEM_12, 0x02) && es8311Update(ES8311_REG_SYSTEM_0D, 0xFA);
+    }
+    stats.lastConfigUs = micros() - start;
+    return ok;
+}
+
+bool es8311SetMute(bool mute) {
+    uint8_t reg31 = (shadow[ES8311_REG_DAC_31] & ~0x60) | (mute ? 0x60 : 0x00);
+    return es8311Update(ES8311_REG_DAC_31, reg31);
+}
+
+bool es8311SetDacVolume(uint8_t value) {
+    return es8311Update(ES8311_REG_DAC_VOLUME, value);
+}
+
+Es8311Stats es8311GetStats() {
+    return stats;
+}
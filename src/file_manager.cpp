@@ -1,120 +1,607 @@
 #include "file_manager.h"
+#include "sd_clock.h"
+#include "track_probe.h"
+#include "decode_cost.h"
 
 SemaphoreHandle_t sdMutex = NULL;
 
-String audioFiles[MAX_FILES];
-uint8_t fileCount = 0;
-uint8_t currentFileIndex = 0;
+uint32_t fileCount = 0;
+uint32_t currentFileIndex = 0;
 String currentFolder = "/";
 
-String availableFolders[20];
+String availableFolders[MAX_FOLDERS];
 uint8_t folderCount = 0;
+uint32_t browseAudioCount = 0;
 
 bool isScanningFiles = false;
-uint8_t scanProgress = 0;
-uint8_t scanTotal = 0;
+uint32_t scanProgress = 0;
+uint32_t scanTotal = 0;
+
+constexpr uint32_t INDEX_MAGIC = 0x3149504D; // "MPI1"
+constexpr uint16_t INDEX_VERSION = 4;
+constexpr size_t MAX_NAME_LEN = 255;
+constexpr uint32_t SCAN_YIELD_EVERY = 32;
+constexpr size_t HEAP_BLOCK_OVERHEAD = 8;
+
+struct TrackIndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t count;
+    uint32_t playable;
+    uint32_t mtime; // folder's last write when it was scanned
+};
+
+constexpr uint8_t TRACK_FLAG_PLAYABLE = 0x01;
+
+// The records are followed by a table of the playable indices, so skipping
+// over bad files is two reads no matter how many of them there are.
+struct TrackRecord {
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    uint8_t flags;
+    uint8_t channels;
+    uint32_t sampleRate;
+    uint32_t durationMs;
+    uint32_t playableRank; // playable entries before this one
+    uint8_t codec;
+    uint8_t bitsPerSample;
+    uint16_t reserved;
+};
+
+struct DirCacheEntry {
+    String path;
+    String folders[MAX_FOLDERS];
+    uint8_t folderCount;
+    uint32_t audioCount;
+    time_t mtime;
+    unsigned long validatedAt;
+    uint32_t lastUse;
+    bool valid;
+};
+
+struct CachedName {
+    uint32_t index;
+    String name;
+};
+
+static File indexFile;
+static File namesFile;
+static String playlistFolder;
+static uint32_t playlistMtime = 0;
+static uint32_t playlistPlayable = 0;
+static CachedName nameCache[TRACK_CACHE_SIZE];
+static DirCacheEntry dirCache[DIR_CACHE_SLOTS];
+// The slot array is always there, so it counts against the ceiling from
+// the start; entries only add the heap their strings hold.
+static DirCacheStats dirCacheStats = {0, 0, 0, sizeof(dirCache), 0};
+static_assert(sizeof(dirCache) < DIR_CACHE_MAX_BYTES, "dir cache slots alone exceed the ceiling");
+static uint32_t lruClock = 0;
+
+static String indexBasePath(const String& folder) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < folder.length(); i++) {
+        hash ^= (uint8_t)folder[i];
+        hash *= 16777619UL;
+    }
+    char buf[24];
+    snprintf(buf, sizeof(buf), INDEX_DIR "/%08lx", (unsigned long)hash);
+    return String(buf);
+}
+
+static String joinPath(const String& folder, const String& name) {
+    if (name.startsWith("/")) return name;
+    return (folder == "/") ? "/" + name : folder + "/" + name;
+}
+
+bool isAudioFile(const String& name) {
+    int dot = name.lastIndexOf('.');
+    if (dot < 0) return false;
+    String ext = name.substring(dot + 1);
+    ext.toLowerCase();
+    return ext == "mp3" || ext == "wav" || ext == "flac";
+}
+
+static void invalidateNameCache() {
+    for (auto &slot : nameCache) {
+        slot.index = UINT32_MAX;
+        slot.name = "";
+    }
+}
+
+static void closeIndex() {
+    if (indexFile) indexFile.close();
+    if (namesFile) namesFile.close();
+    invalidateNameCache();
+}
+
+static bool readFolderMtime(const String& folder, uint32_t& mtime) {
+    File dir = SD.open(folder);
+    bool ok = dir && dir.isDirectory();
+    if (ok) mtime = dir.getLastWrite();
+    if (dir) dir.close();
+    return ok;
+}
+
+// An index is only used if the folder hasn't been written since it was
+// built, the same check the listing cache makes.
+static bool readIndexHeader(File& idx, const String& folder, TrackIndexHeader& header) {
+    uint32_t mtime;
+    return idx.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == INDEX_MAGIC &&
+           header.version == INDEX_VERSION && header.recordSize == sizeof(TrackRecord) &&
+           readFolderMtime(folder, mtime) && header.mtime == mtime;
+}
+
+static bool openIndex(const String& folder) {
+    closeIndex();
+    String base = indexBasePath(folder);
+    indexFile = SD.open(base + ".idx", FILE_READ);
+    namesFile = SD.open(base + ".nam", FILE_READ);
+    if (!indexFile || !namesFile) {
+        closeIndex();
+        return false;
+    }
+
+    TrackIndexHeader header;
+    if (!readIndexHeader(indexFile, folder, header)) {
+        closeIndex();
+        return false;
+    }
+
+    fileCount = header.count;
+    playlistPlayable = header.playable;
+    playlistMtime = header.mtime;
+    playlistFolder = folder;
+    return true;
+}
 
 bool initSDCard() {
+    if (sdMutex == NULL) sdMutex = xSemaphoreCreateMutex();
+
     SPI.begin(SD_SCK, SD_MISO, SD_MOSI);
-    if (!SD.begin(SD_CS)) {
+    if (!sdMountTuned(SD_CS)) {
         Serial.println("ERROR: SD Mount Failed!");
         return false;
     }
     
     uint8_t cardType = SD.cardType();
-    Serial.println("SD Card initialized successfully");
+    Serial.printf("SD Card initialized successfully at %lu kHz\n", (unsigned long)(sdClockHz() / 1000));
     Serial.printf("SD Card Type: %s\n", 
         cardType == CARD_MMC ? "MMC" :
         cardType == CARD_SD ? "SDSC" :
         cardType == CARD_SDHC ? "SDHC" : "UNKNOWN");
     Serial.printf("SD Card Size: %lluMB\n", SD.cardSize() / (1024 * 1024));
+
+    if (!SD.exists(INDEX_DIR)) SD.mkdir(INDEX_DIR);
     
     return true;
 }
 
-void scanDirectory(const String& folder) {
-    fileCount = 0;
-    folderCount = 0;
+static bool scanDirectory(const String& folder, DirCacheEntry& entry) {
+    entry.path = folder;
+    entry.folderCount = 0;
+    entry.audioCount = 0;
     scanProgress = 0;
     scanTotal = 0;
-    currentFolder = folder;
-    
+
     Serial.printf("Scanning directory: %s\n", folder.c_str());
 
     File root = SD.open(folder);
-    if (!root || !root.isDirectory()) {
-        return;
-    }
+    if (!root || !root.isDirectory()) return false;
+    entry.mtime = root.getLastWrite();
 
-    File f = root.openNextFile();
-    while (f && scanTotal < 255) {
-        if (!f.isDirectory()) {
-            String fname = String(f.name());
-            fname.toLowerCase();
-            int8_t dot = fname.lastIndexOf('.');
-            if (dot >= 0) {
-                String ext = fname.substring(dot + 1);
-                if (ext == "mp3" || ext == "wav") scanTotal++;
-            }
-        }
-        f.close();
-        f = root.openNextFile();
-        vTaskDelay(5 / portTICK_PERIOD_MS);
+    bool reopenPlaylist = (folder == playlistFolder);
+    if (reopenPlaylist) closeIndex();
+
+    String base = indexBasePath(folder);
+    File idx = SD.open(base + ".idx", FILE_WRITE);
+    File names = SD.open(base + ".nam", FILE_WRITE);
+    if (!idx || !names) {
+        Serial.println("ERROR: Cannot create track index on SD");
+        root.close();
+        return false;
     }
-    root.close();
-    
-    Serial.printf("Found %d audio files to process\n", scanTotal);
 
-    root = SD.open(folder);
-    f = root.openNextFile();
-    
+    // A placeholder that can't pass readIndexHeader until the real header
+    // goes in last, so a scan cut short by power loss never looks like an
+    // empty folder.
+    TrackIndexHeader header = {0, INDEX_VERSION, sizeof(TrackRecord), 0, 0, 0};
+    idx.write((const uint8_t *)&header, sizeof(header));
+
+    isScanningFiles = true;
+    uint32_t nameOffset = 0;
+    uint32_t entries = 0;
+    uint8_t *playableBits = NULL;
+    size_t playableBytes = 0;
+    File f = root.openNextFile();
     while (f) {
         String fname = String(f.name());
+        int lastSlash = fname.lastIndexOf('/');
+        if (lastSlash >= 0) fname = fname.substring(lastSlash + 1);
 
         if (f.isDirectory()) {
-            if (folderCount < 20) {
-                if (!fname.startsWith("/")) {
-                    fname = (folder == "/") ? "/" + fname : folder + "/" + fname;
-                }
-                availableFolders[folderCount++] = fname;
+            String path = joinPath(folder, fname);
+            if (entry.folderCount < MAX_FOLDERS && path != INDEX_DIR) {
+                entry.folders[entry.folderCount++] = path;
             }
-        } else {
-            if (!fname.startsWith("/")) {
-                fname = (folder == "/") ? "/" + fname : folder + "/" + fname;
+        } else if (isAudioFile(fname) && fname.length() <= MAX_NAME_LEN) {
+            TrackFormat fmt = {};
+            DecodeCost cost;
+            bool playable = probeTrackFile(f, fname, fmt);
+            if (playable && checkDecodeBudget(fmt, cost) == DECODE_REFUSE) {
+                Serial.printf("[Scan] Over decode budget: %s (%lu Hz, %u bit)\n", fname.c_str(),
+                              (unsigned long)fmt.sampleRate, fmt.bitsPerSample);
+                playable = false;
             }
-            
-            String lower = fname;
-            lower.toLowerCase();
-            int8_t dot = lower.lastIndexOf('.');
-
-            if (dot >= 0) {
-                String ext = lower.substring(dot + 1);
-                if (ext == "mp3" || ext == "wav") {
-                    if (fileCount < MAX_FILES) {
-                        audioFiles[fileCount++] = fname;
-                        scanProgress++;
-                    } else break;
+            TrackRecord rec = {nameOffset, (uint16_t)fname.length(), (uint8_t)(playable ? TRACK_FLAG_PLAYABLE : 0),
+                               fmt.channels, fmt.sampleRate, fmt.durationMs, header.playable,
+                               (uint8_t)fmt.codec, fmt.bitsPerSample, 0};
+            if (playable) {
+                if (header.count / 8 >= playableBytes) {
+                    uint8_t *grown = (uint8_t *)realloc(playableBits, playableBytes + 64);
+                    if (grown) {
+                        memset(grown + playableBytes, 0, 64);
+                        playableBits = grown;
+                        playableBytes += 64;
+                    }
+                }
+                if (header.count / 8 < playableBytes) {
+                    playableBits[header.count / 8] |= 1 << (header.count % 8);
+                    header.playable++;
+                } else {
+                    rec.flags = 0;
                 }
+            } else {
+                Serial.printf("[Scan] Unplayable: %s\n", fname.c_str());
             }
+            idx.write((const uint8_t *)&rec, sizeof(rec));
+            names.write((const uint8_t *)fname.c_str(), fname.length());
+            nameOffset += fname.length();
+            header.count++;
+            scanProgress++;
+            scanTotal++;
         }
-        
+
         f.close();
+        // Callers hold sdMutex; hand the card over between entries so a
+        // track change during a long cold scan isn't stuck behind it.
+        xSemaphoreGive(sdMutex);
+        if (++entries % SCAN_YIELD_EVERY == 0) vTaskDelay(1);
+        xSemaphoreTake(sdMutex, portMAX_DELAY);
         f = root.openNextFile();
-        vTaskDelay(5 / portTICK_PERIOD_MS);
     }
-    
     root.close();
+
+    for (uint32_t i = 0; i < header.count && i / 8 < playableBytes; i++) {
+        if (playableBits[i / 8] & (1 << (i % 8))) idx.write((const uint8_t *)&i, sizeof(i));
+    }
+    free(playableBits);
+
+    names.close();
+    idx.flush();
+    header.magic = INDEX_MAGIC;
+    header.mtime = entry.mtime;
+    idx.seek(0);
+    idx.write((const uint8_t *)&header, sizeof(header));
+    idx.close();
+    isScanningFiles = false;
+
+    entry.audioCount = header.count;
+    if (reopenPlaylist && !openIndex(folder)) playlistFolder = "";
+
+    Serial.printf("Indexed %lu audio files (%lu playable), %u folders\n", (unsigned long)entry.audioCount,
+                  (unsigned long)header.playable, entry.folderCount);
+    return true;
+}
+
+// What the heap hands out for a string: the text and its terminator,
+// rounded to the allocator's alignment, plus the block header.
+static size_t stringHeapBytes(const String& s) {
+    if (s.length() == 0) return 0;
+    return ((s.length() + 1 + 3) & ~(size_t)3) + HEAP_BLOCK_OVERHEAD;
+}
+
+static size_t entryBytes(const DirCacheEntry& entry) {
+    size_t bytes = stringHeapBytes(entry.path);
+    for (uint8_t i = 0; i < entry.folderCount; i++) bytes += stringHeapBytes(entry.folders[i]);
+    return bytes;
+}
+
+static void evictEntry(DirCacheEntry& entry) {
+    dirCacheStats.bytes -= entryBytes(entry);
+    dirCacheStats.entries--;
+    dirCacheStats.evictions++;
+    entry.path = "";
+    for (auto &name : entry.folders) name = "";
+    entry.folderCount = 0;
+    entry.valid = false;
 }
 
-String getFileName(uint8_t index) {
+static DirCacheEntry* findEntry(const String& folder) {
+    for (auto &entry : dirCache) {
+        if (entry.valid && entry.path == folder) return &entry;
+    }
+    return NULL;
+}
+
+static DirCacheEntry* lruSlot() {
+    DirCacheEntry *victim = &dirCache[0];
+    for (auto &entry : dirCache) {
+        if (!entry.valid) return &entry;
+        if (entry.lastUse < victim->lastUse) victim = &entry;
+    }
+    evictEntry(*victim);
+    return victim;
+}
+
+static void enforceCeiling(const DirCacheEntry* keep) {
+    while (dirCacheStats.bytes > DIR_CACHE_MAX_BYTES) {
+        DirCacheEntry *victim = NULL;
+        for (auto &entry : dirCache) {
+            if (!entry.valid || &entry == keep) continue;
+            if (victim == NULL || entry.lastUse < victim->lastUse) victim = &entry;
+        }
+        if (victim == NULL) break;
+        evictEntry(*victim);
+    }
+}
+
+static bool entryIsFresh(DirCacheEntry& entry) {
+    unsigned long now = millis();
+    if (now - entry.validatedAt < DIR_CACHE_REVALIDATE_MS) return true;
+
+    File dir = SD.open(entry.path);
+    bool fresh = dir && dir.isDirectory() && dir.getLastWrite() == entry.mtime &&
+                 SD.exists(indexBasePath(entry.path) + ".idx");
+    if (dir) dir.close();
+    if (fresh) entry.validatedAt = now;
+    return fresh;
+}
+
+void openDirectory(const String& path) {
+    // path may alias an availableFolders slot, which is overwritten below
+    String folder = path;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+
+    DirCacheEntry *entry = findEntry(folder);
+    if (entry && entryIsFresh(*entry)) {
+        dirCacheStats.hits++;
+    } else {
+        dirCacheStats.misses++;
+        if (entry) evictEntry(*entry);
+        entry = lruSlot();
+        if (scanDirectory(folder, *entry)) {
+            entry->valid = true;
+            entry->validatedAt = millis();
+            dirCacheStats.entries++;
+            dirCacheStats.bytes += entryBytes(*entry);
+        }
+    }
+
+    currentFolder = folder;
+    folderCount = 0;
+    browseAudioCount = 0;
+    if (entry->valid) {
+        entry->lastUse = ++lruClock;
+        for (uint8_t i = 0; i < entry->folderCount; i++) availableFolders[i] = entry->folders[i];
+        folderCount = entry->folderCount;
+        browseAudioCount = entry->audioCount;
+        enforceCeiling(entry);
+    }
+
+    Serial.printf("[DirCache] %s hits=%lu misses=%lu evictions=%lu bytes=%lu\n", folder.c_str(),
+                  (unsigned long)dirCacheStats.hits, (unsigned long)dirCacheStats.misses,
+                  (unsigned long)dirCacheStats.evictions, (unsigned long)dirCacheStats.bytes);
+
+    xSemaphoreGive(sdMutex);
+}
+
+bool loadPlaylist(const String& folder) {
+    if (folder == playlistFolder && indexFile) return true;
+
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    bool ok = openIndex(folder);
+    if (!ok) {
+        DirCacheEntry *entry = findEntry(folder);
+        if (entry) evictEntry(*entry);
+        DirCacheEntry scratch;
+        ok = scanDirectory(folder, scratch) && openIndex(folder);
+    }
+    if (!ok) {
+        fileCount = 0;
+        playlistPlayable = 0;
+        playlistFolder = "";
+    }
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+static bool peekIndex(const String& folder, TrackIndexHeader& header) {
+    File idx = SD.open(indexBasePath(folder) + ".idx", FILE_READ);
+    bool ok = idx && readIndexHeader(idx, folder, header);
+    if (idx) idx.close();
+    return ok;
+}
+
+bool getFolderTrackCount(const String& folder, uint32_t& count) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    TrackIndexHeader header;
+    bool ok = peekIndex(folder, header);
+    if (!ok) {
+        DirCacheEntry *entry = findEntry(folder);
+        if (entry) evictEntry(*entry);
+        DirCacheEntry scratch;
+        ok = scanDirectory(folder, scratch) && peekIndex(folder, header);
+    }
+    xSemaphoreGive(sdMutex);
+    if (ok) count = header.count;
+    return ok;
+}
+
+String getPlaylistFolder() {
+    return playlistFolder;
+}
+
+uint32_t getPlaylistMtime() {
+    return playlistMtime;
+}
+
+bool getFolderMtime(const String& folder, uint32_t& mtime) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    bool ok = readFolderMtime(folder, mtime);
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+DirCacheStats getDirCacheStats() {
+    return dirCacheStats;
+}
+
+static void loadWindow(uint32_t first, uint32_t count) {
+    if (!indexFile || !namesFile || first >= fileCount) return;
+    if (count > TRACK_CACHE_SIZE) count = TRACK_CACHE_SIZE;
+    if (first + count > fileCount) count = fileCount - first;
+
+    TrackRecord recs[TRACK_CACHE_SIZE];
+    indexFile.seek(sizeof(TrackIndexHeader) + first * sizeof(TrackRecord));
+    size_t got = indexFile.read((uint8_t *)recs, count * sizeof(TrackRecord)) / sizeof(TrackRecord);
+    if (got == 0) return;
+
+    char buf[MAX_NAME_LEN + 1];
+    namesFile.seek(recs[0].nameOffset);
+    for (size_t i = 0; i < got; i++) {
+        CachedName &slot = nameCache[(first + i) % TRACK_CACHE_SIZE];
+        if (slot.index == first + i) {
+            namesFile.seek(recs[i].nameOffset + recs[i].nameLength);
+            continue;
+        }
+        if (namesFile.position() != recs[i].nameOffset) namesFile.seek(recs[i].nameOffset);
+        size_t len = namesFile.read((uint8_t *)buf, recs[i].nameLength);
+        buf[len] = '\0';
+        slot.index = first + i;
+        slot.name = buf;
+    }
+}
+
+void prefetchTracks(uint32_t first, uint32_t count) {
+    if (fileCount == 0) return;
+    uint32_t start = (first > TRACK_LOOKAHEAD) ? first - TRACK_LOOKAHEAD : 0;
+    uint32_t span = count + 2 * TRACK_LOOKAHEAD;
+
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    for (uint32_t i = first; i < first + count && i < fileCount; i++) {
+        if (nameCache[i % TRACK_CACHE_SIZE].index != i) {
+            loadWindow(start, span);
+            break;
+        }
+    }
+    xSemaphoreGive(sdMutex);
+}
+
+static String cachedName(uint32_t index) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    CachedName &slot = nameCache[index % TRACK_CACHE_SIZE];
+    if (slot.index != index) loadWindow(index, 1);
+    String name = (slot.index == index) ? slot.name : String("");
+    xSemaphoreGive(sdMutex);
+    return name;
+}
+
+String getTrackPath(uint32_t index) {
+    if (index >= fileCount) return "";
+    return joinPath(playlistFolder, cachedName(index));
+}
+
+String getFileName(uint32_t index) {
     if (index >= fileCount) return "";
     
-    String fname = audioFiles[index];
-    int8_t lastSlash = fname.lastIndexOf('/');
-    if (lastSlash >= 0) fname = fname.substring(lastSlash + 1);
-    
-    int8_t lastDot = fname.lastIndexOf('.');
+    String fname = cachedName(index);
+    int lastDot = fname.lastIndexOf('.');
     if (lastDot > 0) fname = fname.substring(0, lastDot);
     
     return fname;
-}
\ No newline at end of file
+}
+
+int32_t findTrack(const String& name) {
+    int32_t found = -1;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    for (uint32_t first = 0; first < fileCount && found < 0; first += TRACK_CACHE_SIZE) {
+        loadWindow(first, TRACK_CACHE_SIZE);
+        for (uint32_t i = first; i < first + TRACK_CACHE_SIZE && i < fileCount; i++) {
+            const CachedName &slot = nameCache[i % TRACK_CACHE_SIZE];
+            if (slot.index == i && slot.name == name) {
+                found = i;
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(sdMutex);
+    return found;
+}
+
+static bool readRecord(uint32_t index, TrackRecord& rec) {
+    return indexFile && index < fileCount &&
+           indexFile.seek(sizeof(TrackIndexHeader) + index * sizeof(TrackRecord)) &&
+           indexFile.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+}
+
+static int32_t playableAt(uint32_t rank) {
+    uint32_t index;
+    uint32_t offset = sizeof(TrackIndexHeader) + fileCount * sizeof(TrackRecord) + rank * sizeof(index);
+    if (rank >= playlistPlayable || !indexFile.seek(offset) ||
+        indexFile.read((uint8_t *)&index, sizeof(index)) != sizeof(index) || index >= fileCount) {
+        return -1;
+    }
+    return index;
+}
+
+uint32_t getPlayableCount() {
+    return playlistPlayable;
+}
+
+bool getTrackFormat(uint32_t index, TrackFormat& fmt) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    TrackRecord rec;
+    bool ok = readRecord(index, rec) && (rec.flags & TRACK_FLAG_PLAYABLE);
+    if (ok) {
+        fmt.sampleRate = rec.sampleRate;
+        fmt.durationMs = rec.durationMs;
+        fmt.blockFrames = 0;
+        fmt.bitsPerSample = rec.bitsPerSample;
+        fmt.channels = rec.channels;
+        fmt.codec = (TrackCodec)rec.codec;
+    }
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+bool isTrackPlayable(uint32_t index) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    TrackRecord rec;
+    bool ok = readRecord(index, rec) && (rec.flags & TRACK_FLAG_PLAYABLE);
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+int32_t nextPlayable(uint32_t index, int8_t direction) {
+    if (playlistPlayable == 0) return -1;
+    int32_t found = -1;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    TrackRecord rec;
+    if (readRecord(index, rec)) {
+        uint32_t rank = rec.playableRank;
+        if (direction > 0) rank += (rec.flags & TRACK_FLAG_PLAYABLE) ? 1 : 0;
+        else rank += playlistPlayable - 1;
+        found = playableAt(rank % playlistPlayable);
+    }
+    xSemaphoreGive(sdMutex);
+    return found;
+}
+
+int32_t randomPlayable() {
+    if (playlistPlayable == 0) return -1;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    int32_t found = playableAt(random(0, playlistPlayable));
+    xSemaphoreGive(sdMutex);
+    return found;
+}
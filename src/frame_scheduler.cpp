@@ -0,0 +1,94 @@
+#include "frame_scheduler.h"
+
+constexpr unsigned long STATS_WINDOW_MS = 1000;
+
+static TaskHandle_t uiTaskHandle = NULL;
+static bool redrawArmed = false;
+static unsigned long redrawDeadline = 0;
+
+static FrameStats stats = {};
+static unsigned long frameStartUs = 0;
+static unsigned long windowStart = 0;
+static uint32_t windowFrames = 0;
+static uint64_t windowBusyUs = 0;
+static uint32_t windowMaxUs = 0;
+
+static void rollStatsWindow(unsigned long now) {
+    unsigned long elapsed = now - windowStart;
+    if (elapsed < STATS_WINDOW_MS) return;
+
+    stats.fpsX10 = (uint16_t)((windowFrames * 10000UL) / elapsed);
+    stats.avgFrameUs = windowFrames ? (uint32_t)(windowBusyUs / windowFrames) : 0;
+    stats.maxFrameUs = windowMaxUs;
+
+    windowStart = now;
+    windowFrames = 0;
+    windowBusyUs = 0;
+    windowMaxUs = 0;
+}
+
+void initFrameScheduler(TaskHandle_t uiTask) {
+    uiTaskHandle = uiTask;
+    windowStart = millis();
+}
+
+void requestRedraw(uint32_t reason) {
+    if (uiTaskHandle == NULL) return;
+    xTaskNotify(uiTaskHandle, reason, eSetBits);
+}
+
+void IRAM_ATTR requestRedrawFromISR(uint32_t reason) {
+    if (uiTaskHandle == NULL) return;
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(uiTaskHandle, reason, eSetBits, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void scheduleRedrawIn(uint32_t ms) {
+    unsigned long deadline = millis() + ms;
+    if (!redrawArmed || (long)(deadline - redrawDeadline) < 0) {
+        redrawDeadline = deadline;
+        redrawArmed = true;
+    }
+}
+
+void cancelScheduledRedraw() {
+    redrawArmed = false;
+}
+
+uint32_t waitForFrameEvent(uint32_t maxWaitMs) {
+    uint32_t timeout = maxWaitMs;
+    if (redrawArmed) {
+        long remaining = (long)(redrawDeadline - millis());
+        if (remaining < 0) remaining = 0;
+        if ((uint32_t)remaining < timeout) timeout = remaining;
+    }
+
+    uint32_t reasons = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &reasons, pdMS_TO_TICKS(timeout));
+
+    unsigned long now = millis();
+    if (redrawArmed && (long)(now - redrawDeadline) >= 0) {
+        redrawArmed = false;
+        reasons |= REDRAW_ANIMATION;
+    }
+    rollStatsWindow(now);
+    return reasons;
+}
+
+void beginFrame() {
+    frameStartUs = micros();
+}
+
+void endFrame() {
+    uint32_t frameUs = micros() - frameStartUs;
+    windowFrames++;
+    windowBusyUs += frameUs;
+    if (frameUs > windowMaxUs) windowMaxUs = frameUs;
+    stats.totalFrames++;
+    rollStatsWindow(millis());
+}
+
+FrameStats getFrameStats() {
+    return stats;
+}
@@ -0,0 +1,114 @@
+#include "input_manager.h"
+#include "M5Cardputer.h"
+#include "frame_scheduler.h"
+
+constexpr uint8_t INPUT_QUEUE_SIZE = 16;
+constexpr uint32_t REPEAT_DELAY_MS = 350;
+constexpr uint32_t REPEAT_START_MS = 120;
+constexpr uint32_t REPEAT_MIN_MS = 25;
+constexpr uint32_t REPEAT_ACCEL_MS = 8;
+
+struct HeldKey {
+    bool active;
+    char key;
+    uint16_t count;
+    unsigned long nextRepeat;
+};
+
+static InputEvent inputQueue[INPUT_QUEUE_SIZE];
+static uint8_t queueHead = 0;
+static uint8_t queueTail = 0;
+
+static bool irqAttached = false;
+static volatile bool irqPending = true;
+static volatile uint32_t irqTimestampUs = 0;
+static HeldKey held = {false, 0, 0, 0};
+static unsigned long lastScan = 0;
+
+static void IRAM_ATTR keyboardIsr() {
+    if (!irqPending) {
+        irqTimestampUs = (uint32_t)esp_timer_get_time();
+        irqPending = true;
+    }
+    requestRedrawFromISR(REDRAW_INPUT);
+}
+
+static bool isRepeatable(char key) {
+    return key == ';' || key == '.' || key == 'c' || key == 'v' || key == 'k' || key == 'l' || key == '-' || key == '=';
+}
+
+static bool pushEvent(char key, uint16_t repeat, uint32_t timestampUs) {
+    uint8_t next = (queueHead + 1) % INPUT_QUEUE_SIZE;
+    if (next == queueTail) return false;
+    inputQueue[queueHead] = {key, repeat, timestampUs};
+    queueHead = next;
+    return true;
+}
+
+void initInput() {
+    pinMode(CARDPUTER_KB_INT_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(CARDPUTER_KB_INT_PIN), keyboardIsr, FALLING);
+    irqAttached = true;
+}
+
+bool inputInterruptActive() {
+    return irqAttached;
+}
+
+// Keys from the remote protocol; queued on Task_TFT like scanned ones.
+bool injectInput(char key, uint16_t repeat) {
+    return pushEvent(key, repeat, micros());
+}
+
+bool pollInput() {
+    bool produced = false;
+    unsigned long now = millis();
+
+    if (irqPending || !irqAttached || held.active || now - lastScan >= INPUT_FALLBACK_POLL_MS) {
+        uint32_t timestampUs = irqPending ? irqTimestampUs : micros();
+        irqPending = false;
+        lastScan = now;
+
+        M5Cardputer.update();
+        if (M5Cardputer.Keyboard.isChange()) {
+            held.active = false;
+            if (M5Cardputer.Keyboard.isPressed()) {
+                Keyboard_Class::KeysState ks = M5Cardputer.Keyboard.keysState();
+                if (ks.opt && ks.word.size() == 1 && ks.word[0] == 'd') {
+                    pushEvent(INPUT_KEY_DIAGNOSTICS, 0, timestampUs);
+                } else {
+                    for (auto ch : ks.word) pushEvent(ch, 0, timestampUs);
+                }
+                if (ks.enter) pushEvent('\n', 0, timestampUs);
+                if (ks.del) pushEvent('\b', 0, timestampUs);
+                produced = true;
+
+                if (ks.word.size() == 1 && isRepeatable(ks.word[0])) {
+                    held = {true, ks.word[0], 0, now + REPEAT_DELAY_MS};
+                }
+            }
+        }
+    }
+
+    if (held.active && (long)(now - held.nextRepeat) >= 0) {
+        held.count++;
+        pushEvent(held.key, held.count, micros());
+        uint32_t accel = min<uint32_t>(held.count * REPEAT_ACCEL_MS, REPEAT_START_MS - REPEAT_MIN_MS);
+        held.nextRepeat = now + REPEAT_START_MS - accel;
+        produced = true;
+    }
+    return produced;
+}
+
+bool nextInputEvent(InputEvent &evt) {
+    if (queueTail == queueHead) return false;
+    evt = inputQueue[queueTail];
+    queueTail = (queueTail + 1) % INPUT_QUEUE_SIZE;
+    return true;
+}
+
+uint32_t msUntilInputDeadline() {
+    if (!held.active) return UINT32_MAX;
+    long remaining = (long)(held.nextRepeat - millis());
+    return remaining > 0 ? remaining : 0;
+}
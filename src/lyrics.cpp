@@ -0,0 +1,189 @@
+#include "lyrics.h"
+#include "file_manager.h"
+#include <algorithm>
+
+struct LyricEntry {
+    uint32_t timeMs;
+    uint32_t offset : 24;
+    uint32_t length : 8;
+};
+
+static LyricEntry entries[LYRICS_MAX_LINES];
+static size_t entryCount = 0;
+static File lyricsFile;
+static size_t cursor = 0;
+static int32_t cachedLine = -1;
+static String cachedText;
+
+static bool parseTimeTag(const char *tag, size_t len, uint32_t &ms) {
+    // mm:ss, mm:ss.xx or mm:ss.xxx
+    uint32_t minutes = 0, seconds = 0, fraction = 0, fractionDigits = 0;
+    size_t i = 0;
+    while (i < len && isdigit((uint8_t)tag[i])) minutes = minutes * 10 + (tag[i++] - '0');
+    if (i == 0 || i >= len || tag[i++] != ':') return false;
+    size_t secStart = i;
+    while (i < len && isdigit((uint8_t)tag[i])) seconds = seconds * 10 + (tag[i++] - '0');
+    if (i == secStart) return false;
+    if (i < len && (tag[i] == '.' || tag[i] == ':')) {
+        i++;
+        while (i < len && isdigit((uint8_t)tag[i]) && fractionDigits < 3) {
+            fraction = fraction * 10 + (tag[i++] - '0');
+            fractionDigits++;
+        }
+    }
+    while (fractionDigits < 3) {
+        fraction *= 10;
+        fractionDigits++;
+    }
+    ms = (minutes * 60 + seconds) * 1000 + fraction;
+    return true;
+}
+
+static void indexLine(const char *line, size_t len, uint32_t lineOffset, int32_t &offsetMs) {
+    uint32_t times[8];
+    size_t timeCount = 0;
+    size_t pos = 0;
+
+    while (pos < len && line[pos] == '[') {
+        const char *close = (const char *)memchr(line + pos, ']', len - pos);
+        if (close == NULL) return;
+        const char *tag = line + pos + 1;
+        size_t tagLen = close - tag;
+        uint32_t ms;
+        if (parseTimeTag(tag, tagLen, ms)) {
+            if (timeCount < 8) times[timeCount++] = ms;
+        } else if (tagLen > 7 && strncmp(tag, "offset:", 7) == 0) {
+            offsetMs = atoi(tag + 7);
+        }
+        pos = close - line + 1;
+    }
+
+    size_t textLen = min(len - pos, LYRICS_MAX_LINE_LEN);
+    for (size_t t = 0; t < timeCount && entryCount < LYRICS_MAX_LINES; t++) {
+        entries[entryCount].timeMs = times[t];
+        entries[entryCount].offset = lineOffset + pos;
+        entries[entryCount].length = textLen;
+        entryCount++;
+    }
+}
+
+void clearLyrics() {
+    entryCount = 0;
+    cursor = 0;
+    cachedLine = -1;
+    cachedText = "";
+    if (lyricsFile) {
+        xSemaphoreTake(sdMutex, portMAX_DELAY);
+        lyricsFile.close();
+        xSemaphoreGive(sdMutex);
+    }
+}
+
+bool lyricsLoaded() {
+    return entryCount > 0;
+}
+
+bool loadLyrics(const String &trackPath) {
+    clearLyrics();
+    int dot = trackPath.lastIndexOf('.');
+    String path = ((dot > 0) ? trackPath.substring(0, dot) : trackPath) + ".lrc";
+
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File f = SD.open(path, FILE_READ);
+    if (!f) {
+        xSemaphoreGive(sdMutex);
+        return false;
+    }
+
+    unsigned long start = millis();
+    int32_t offsetMs = 0;
+    char line[LYRICS_MAX_LINE_LEN + 64];
+    char buf[256];
+    size_t lineLen = 0;
+    uint32_t lineOffset = 0;
+    uint32_t filePos = 0;
+    bool overflow = false;
+    int got;
+    while ((got = f.read((uint8_t *)buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < got; i++, filePos++) {
+            char c = buf[i];
+            if (c == '\n') {
+                if (lineLen > 0 && line[lineLen - 1] == '\r') lineLen--;
+                if (!overflow) indexLine(line, lineLen, lineOffset, offsetMs);
+                lineLen = 0;
+                lineOffset = filePos + 1;
+                overflow = false;
+            } else if (lineLen < sizeof(line)) {
+                line[lineLen++] = c;
+            } else {
+                overflow = true;
+            }
+        }
+    }
+    if (lineLen > 0 && !overflow) indexLine(line, lineLen, lineOffset, offsetMs);
+    if (entryCount > 0) {
+        lyricsFile = f;
+    } else {
+        f.close();
+    }
+    xSemaphoreGive(sdMutex);
+
+    std::stable_sort(entries, entries + entryCount,
+                     [](const LyricEntry &a, const LyricEntry &b) { return a.timeMs < b.timeMs; });
+    if (offsetMs != 0) {
+        for (size_t i = 0; i < entryCount; i++) {
+            // A positive LRC offset shows lyrics earlier
+            int32_t t = (int32_t)entries[i].timeMs - offsetMs;
+            entries[i].timeMs = t > 0 ? t : 0;
+        }
+    }
+
+    Serial.printf("[Lyrics] %s: %u lines indexed in %lu ms\n", path.c_str(), (unsigned)entryCount, millis() - start);
+    return entryCount > 0;
+}
+
+// Steps the cursor forward during normal playback; seeks and large jumps
+// fall back to a binary search.
+int32_t lyricLineAt(uint32_t positionMs) {
+    if (entryCount == 0 || positionMs < entries[0].timeMs) {
+        cursor = 0;
+        return -1;
+    }
+
+    if (positionMs < entries[cursor].timeMs) {
+        const LyricEntry *it = std::upper_bound(entries, entries + entryCount, positionMs,
+                                                [](uint32_t ms, const LyricEntry &e) { return ms < e.timeMs; });
+        cursor = (it - entries) - 1;
+    } else {
+        size_t steps = 0;
+        while (cursor + 1 < entryCount && entries[cursor + 1].timeMs <= positionMs) {
+            if (++steps > 4) {
+                const LyricEntry *it = std::upper_bound(entries + cursor, entries + entryCount, positionMs,
+                                                        [](uint32_t ms, const LyricEntry &e) { return ms < e.timeMs; });
+                cursor = (it - entries) - 1;
+                break;
+            }
+            cursor++;
+        }
+    }
+    return cursor;
+}
+
+const String &lyricText(int32_t line) {
+    if (line < 0 || (size_t)line >= entryCount) {
+        static const String empty;
+        return empty;
+    }
+    if (line == cachedLine) return cachedText;
+
+    char buf[LYRICS_MAX_LINE_LEN + 1];
+    int len = 0;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    if (lyricsFile.seek(entries[line].offset)) len = lyricsFile.read((uint8_t *)buf, entries[line].length);
+    xSemaphoreGive(sdMutex);
+
+    buf[len > 0 ? len : 0] = '\0';
+    cachedText = buf;
+    cachedLine = line;
+    return cachedText;
+}
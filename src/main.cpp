@@ -3,6 +3,24 @@
 #include "audio_config.h"
 #include "file_manager.h"
 #include "ui_manager.h"
+#include "frame_scheduler.h"
+#include "profiler.h"
+#include "player_control.h"
+#include "input_manager.h"
+#include "sensor_service.h"
+#include "audio_output.h"
+#include "power_governor.h"
+#include "es8311.h"
+#include "track_probe.h"
+#include "playback_state.h"
+#include "album_art.h"
+#include "decode_bench.h"
+#include "sd_clock.h"
+#include "remote_control.h"
+#include "signal_gen.h"
+#include "decode_cost.h"
+#include "time_stretch.h"
+#include "waveform.h"
 #include <utility/Keyboard/KeyboardReader/TCA8418.h>
 
 TaskHandle_t handleUITask = NULL;
@@ -11,6 +29,7 @@ TaskHandle_t handleAudioTask = NULL;
 void Task_TFT(void *pvParameters);
 void Task_Audio(void *pvParameters);
 void audio_eof_mp3(const char *info);
+void audio_process_i2s(int16_t *outBuff, uint16_t validSamples, uint8_t bitsPerSample, uint8_t channels, bool *continueI2S);
 
 void setup() {
     auto cfg = M5.config();
@@ -23,33 +42,304 @@ void setup() {
     std::unique_ptr<KeyboardReader> reader(new TCA8418KeyboardReader());
     M5Cardputer.Keyboard.begin(std::move(reader));
 
+    initSensors();
+    initDecodeCosts();
+    initPowerGovernor();
 
     xTaskCreatePinnedToCore(Task_TFT, "Task_TFT", 20480, NULL, 2, &handleUITask, 0);
     xTaskCreatePinnedToCore(Task_Audio, "Task_Audio", 12288, NULL, 3, &handleAudioTask, 1);
+    profilerRegisterTask(PROF_TASK_UI, handleUITask);
+    profilerRegisterTask(PROF_TASK_AUDIO, handleAudioTask);
+    initPlayerControl(handleAudioTask);
 }
 
 void loop() {
-    updateHeadphoneDetection();
-    delay(100);
+    vTaskDelete(NULL);
 }
 
 void Task_TFT(void *pvParameters) {
+    initFrameScheduler(xTaskGetCurrentTaskHandle());
     initUI();
     initSDCard();
-    scanDirectory(currentFolder);
-    
+    initAlbumArt();
+    initWaveform();
+    initPlaybackState();
+    if (!resumeLastSession()) openDirectory(currentFolder);
+    initInput();
+
+    uint32_t reasons = REDRAW_STATE;
+    unsigned long lastLog = 0;
+
     while (true) {
-        M5Cardputer.update();
-        if (M5Cardputer.Keyboard.isChange() && M5Cardputer.Keyboard.isPressed()) {
-            Keyboard_Class::KeysState ks = M5Cardputer.Keyboard.keysState();
-            for (auto ch : ks.word) handleKeyPress(ch);
-            if (ks.enter) handleKeyPress('\n');
-            if (ks.del) handleKeyPress('\b');
+        unsigned long busyStart = micros();
+        uint32_t inputStartUs = 0;
+        profilerWakeup(PROF_TASK_UI);
+        InputEvent evt;
+
+        pollInput();
+        pollRemote();
+        while (nextInputEvent(evt)) {
+            if (inputStartUs == 0) inputStartUs = evt.timestampUs;
+            setCommandOrigin(evt.timestampUs);
+            handleKeyPress(evt.key, evt.repeat);
+            reasons |= REDRAW_INPUT;
+        }
+        setCommandOrigin(0);
+
+        if (processPlayerEvents()) reasons |= REDRAW_STATE;
+        checkScreenTimeout();
+
+        if (reasons && draw() && inputStartUs != 0) {
+            profilerLatency(PROF_LAT_KEY_TO_PIXELS, micros() - inputStartUs);
+        }
+        if (profilerUpdate()) powerGovernorUpdate();
+
+        if (millis() - lastLog >= 5000) {
+            FrameStats fs = getFrameStats();
+            Serial.printf("[Task_TFT] fps=%u.%u frame avg=%luus max=%luus total=%lu\n",
+                          fs.fpsX10 / 10, fs.fpsX10 % 10, (unsigned long)fs.avgFrameUs,
+                          (unsigned long)fs.maxFrameUs, (unsigned long)fs.totalFrames);
+            lastLog = millis();
         }
 
-        draw();
-        vTaskDelay(40 / portTICK_PERIOD_MS);
+        profilerAddBusy(PROF_TASK_UI, micros() - busyStart);
+        reasons = waitForFrameEvent(min(min(getInputPollMs(), msUntilInputDeadline()), remotePollMs()));
+    }
+}
+
+static bool trackLoaded = false;
+static bool trackPaused = false;
+static bool pausePending = false;
+static unsigned long pauseRequestedMs = 0;
+static bool trackEnded = false;
+static uint32_t trackIndex = 0;
+static uint32_t skipIssuedUs = 0;
+static bool trackFlac = false;
+static uint32_t pendingSeekMs = 0;
+static bool pendingSeekDecoded = false;
+static TrackFormat trackFormat;
+static char trackPath[PLAYER_PATH_MAX];
+static bool diagActive = false;
+static SignalGen diagGen;
+
+static bool prepareOutput(const char *path) {
+    TrackFormat &fmt = trackFormat;
+    if (!probeTrackFormat(path, fmt)) return true; // decoder's rate is picked up on the first frame
+
+    DecodeCost cost;
+    DecodeVerdict verdict = checkDecodeBudget(fmt, cost);
+    if (verdict != DECODE_OK) {
+        Serial.printf("[Task_Media] %s: decode needs ~%u.%u%% of core 1 and %lu B heap (%s)\n",
+                      verdict == DECODE_REFUSE ? "Refusing" : "WARNING", cost.cpuPermille / 10, cost.cpuPermille % 10,
+                      (unsigned long)cost.heapBytes, cost.measured ? "measured" : "estimated");
+        if (verdict == DECODE_REFUSE) return false;
+    }
+    trackFlac = fmt.codec == CODEC_FLAC;
+    // A pause can land anywhere in one decoder call, and the stretch stage
+    // may add a sequence on top at the slowest speed.
+    size_t block = max((size_t)fmt.blockFrames, AUDIO_OUTPUT_HOLD_FRAMES / 2);
+    if (!audioOutputReserveHold(block * 100 / STRETCH_SPEED_MIN + STRETCH_SEQUENCE_FRAMES)) return false;
+    return audioOutputSetSampleRate(fmt.sampleRate);
+}
+
+// The decoder seeks FLAC by average bitrate, which drifts on VBR streams;
+// the file's own seek table gets much closer. landedMs is where playback
+// actually resumes: the decoder's own seek only lands on whole seconds,
+// clamped to the duration it has parsed so far.
+static bool seekTrack(uint32_t positionMs, uint32_t &landedMs) {
+    uint32_t offset;
+    if (trackFlac && probeFlacSeek(trackPath, positionMs, offset) && audio.setFilePos(offset)) {
+        landedMs = positionMs;
+        return true;
+    }
+    if (!audio.setAudioPlayPosition(positionMs / 1000)) return false;
+    landedMs = min(positionMs / 1000, audio.getAudioFileDuration()) * 1000;
+    return true;
+}
+
+// Position is counted on the output side: every frame the output takes
+// stands for speed/100 source frames, and whatever is still queued for
+// DMA or held across a pause has not been heard yet.
+static uint32_t positionBaseMs = 0;
+static uint64_t outputSourceX100 = 0;
+
+static void resetPosition(uint32_t baseMs) {
+    positionBaseMs = baseMs;
+    outputSourceX100 = 0;
+}
+
+// A start offset has to wait until the decoder knows the duration, or has
+// at least decoded a frame; right after connecting it would clamp the seek
+// to 0. Output is dropped meanwhile so the start of the file isn't heard.
+static void applyPendingSeek() {
+    if (pendingSeekMs == 0 || (audio.getAudioFileDuration() == 0 && !pendingSeekDecoded)) return;
+    uint32_t landedMs;
+    resetPosition(seekTrack(pendingSeekMs, landedMs) ? landedMs : 0);
+    pendingSeekMs = 0;
+    pendingSeekDecoded = false;
+}
+
+static size_t writeOutput(const int16_t *frames, size_t frameCount) {
+    size_t written = audioOutputWrite(frames, frameCount);
+    outputSourceX100 += (uint64_t)written * timeStretchSpeed();
+    return written;
+}
+
+static uint32_t playPositionMs() {
+    uint64_t pendingX100 = (uint64_t)audioOutputPendingFrames() * timeStretchSpeed();
+    uint64_t heard = outputSourceX100 > pendingX100 ? (outputSourceX100 - pendingX100) / 100 : 0;
+    return positionBaseMs + (uint32_t)(heard * 1000 / audioOutputSampleRate());
+}
+
+static void startTrack(const PlayerCommand &cmd) {
+    audio.stopSong();
+    audioOutputReset();
+    timeStretchReset();
+    resetPosition(0);
+    audioOutputIdle();
+    waveformCaptureAbort();
+    trackLoaded = false;
+    trackPaused = false;
+    pausePending = false;
+    trackEnded = false;
+    trackIndex = cmd.trackIndex;
+    beginPlayGeneration(cmd.generation);
+    skipIssuedUs = 0;
+    diagActive = false;
+    trackFlac = false;
+    pendingSeekMs = 0;
+    pendingSeekDecoded = false;
+    trackFormat.durationMs = 0;
+    strlcpy(trackPath, cmd.path, sizeof(trackPath));
+
+    Serial.printf("[Task_Media] Loading track %lu: %s\n", (unsigned long)cmd.trackIndex, cmd.path);
+
+    if (!codec_initialized) {
+        Serial.println("WARNING: Codec not initialized, cannot play track.");
+    } else if (!SD.exists(cmd.path)) {
+        Serial.println("ERROR: Track file not found on SD.");
+    } else if (!es8311SetPower(ES8311_POWER_ON) || !prepareOutput(cmd.path) || !audio.connecttoFS(SD, cmd.path)) {
+        Serial.println("ERROR: Failed to connect track to codec.");
+    } else {
+        Serial.println("[Task_Media] Track connected successfully.");
+        if (cmd.value > 0) pendingSeekMs = cmd.value;
+        else waveformCaptureBegin(cmd.path, trackFormat.sampleRate, trackFormat.durationMs);
+        trackLoaded = true;
+        skipIssuedUs = cmd.issuedUs;
+    }
+
+    if (trackLoaded) {
+        postPlayerEvent(EVT_TRACK_STARTED, trackIndex, audio.getAudioFileDuration() * 1000UL);
+    } else {
+        postPlayerEvent(EVT_TRACK_FAILED, trackIndex);
+    }
+}
+
+static void handlePlayerCommand(const PlayerCommand &cmd) {
+    switch (cmd.type) {
+    case CMD_PLAY:
+        startTrack(cmd);
+        break;
+    case CMD_PAUSE:
+        if (trackLoaded && !trackPaused && !pausePending) {
+            pausePending = true;
+            pauseRequestedMs = millis();
+            audioOutputPause(cmd.originUs ? cmd.originUs : micros());
+        }
+        break;
+    case CMD_RESUME:
+        if (trackLoaded && (trackPaused || pausePending)) {
+            trackPaused = false;
+            pausePending = false;
+            audioOutputResume();
+            postPlayerEvent(EVT_RESUMED, trackIndex, playPositionMs());
+        }
+        break;
+    case CMD_STOP:
+        audio.stopSong();
+        audioOutputReset();
+        timeStretchReset();
+        waveformCaptureAbort();
+        diagActive = false;
+        trackLoaded = false;
+        trackPaused = false;
+        pausePending = false;
+        if (codec_initialized) es8311SetPower(ES8311_POWER_STANDBY);
+        postPlayerEvent(EVT_STOPPED, trackIndex);
+        break;
+    case CMD_SEEK:
+        if (trackLoaded) {
+            timeStretchReset();
+            waveformCaptureAbort();
+            uint32_t landedMs;
+            if (pendingSeekMs != 0) {
+                pendingSeekMs = cmd.value;
+                pendingSeekDecoded = false;
+            } else if (seekTrack(cmd.value, landedMs)) {
+                resetPosition(landedMs);
+            }
+        }
+        break;
+    case CMD_VOLUME:
+        audio.setVolume(cmd.value);
+        break;
+    case CMD_BENCHMARK:
+    case CMD_SD_BENCHMARK:
+        audio.stopSong();
+        audioOutputReset();
+        audioOutputIdle();
+        waveformCaptureAbort();
+        diagActive = false;
+        trackLoaded = false;
+        trackPaused = false;
+        pausePending = false;
+        postPlayerEvent(EVT_STOPPED, trackIndex);
+        if (cmd.type == CMD_BENCHMARK) {
+            runDecodeBenchmark(cmd.path);
+        } else {
+            SdBenchResult results[8];
+            sdBenchmark(results, 8);
+        }
+        trackEnded = false;
+        break;
+    case CMD_DIAGNOSTICS:
+        audio.stopSong();
+        audioOutputReset();
+        waveformCaptureAbort();
+        trackLoaded = false;
+        trackPaused = false;
+        pausePending = false;
+        diagActive = cmd.value >= 0 && cmd.value < SIG_COUNT;
+        if (diagActive) {
+            if (codec_initialized) es8311SetPower(ES8311_POWER_ON);
+            audioOutputSetSampleRate(AUDIO_OUTPUT_DEFAULT_RATE);
+            signalStart(diagGen, (SignalType)cmd.value, audioOutputSampleRate());
+        }
+        Serial.printf("[Diag] signal: %s\n", diagActive ? signalName(diagGen.type) : "off");
+        postPlayerEvent(EVT_STOPPED, trackIndex);
+        break;
+    case CMD_SPEED:
+        timeStretchSetSpeed(cmd.value, writeOutput);
+        Serial.printf("[Task_Media] Speed %u%%\n", timeStretchSpeed());
+        break;
     }
+
+    if (cmd.originUs != 0) profilerLatency(PROF_LAT_KEY_TO_AUDIO, micros() - cmd.originUs);
+}
+
+// One DMA buffer per pass; the blocking write paces the loop exactly as it
+// does for decoded audio.
+static void renderDiagnostics() {
+    static int16_t block[AUDIO_OUTPUT_DMA_LEN * 2];
+    int32_t click = signalRender(diagGen, block, AUDIO_OUTPUT_DMA_LEN);
+    audioOutputWrite(block, AUDIO_OUTPUT_DMA_LEN);
+    if (click < 0) return;
+
+    // The click reaches the DAC once everything queued ahead of it has drained.
+    AudioOutputStats ao = getAudioOutputStats();
+    uint32_t behindUs = (uint64_t)(AUDIO_OUTPUT_DMA_LEN - click) * 1000000ULL / ao.sampleRate;
+    Serial.printf("$CLK,%lu,%lu,%lu\n", (unsigned long)diagGen.clicks,
+                  (unsigned long)(micros() + ao.latencyUs - behindUs), (unsigned long)ao.latencyUs);
 }
 
 void Task_Audio(void *pvParameters) {
@@ -60,70 +350,100 @@ void Task_Audio(void *pvParameters) {
     }
 
     const TickType_t playDelay = pdMS_TO_TICKS(1);
-    const TickType_t idleDelay = pdMS_TO_TICKS(20);
+    const TickType_t idleDelay = pdMS_TO_TICKS(1000);
+    const unsigned long positionInterval = 250;
+    const unsigned long pauseFadeTimeout = 50;
     unsigned long lastLog = 0;
+    unsigned long lastPosition = 0;
+    bool inputDry = false;
+    PlayerCommand cmd;
 
     while (true) {
-        if (nextTrackRequest && fileCount > 0) {
-            audio.stopSong();
-            trackStartMillis = millis();
-            playbackTime = 0;
-
-            const String &trackPath = audioFiles[currentFileIndex];
-            Serial.printf("[Task_Media] Loading track %d: %s\n", currentFileIndex, trackPath.c_str());
-
-            if (SD.exists(trackPath)) {
-                if (codec_initialized) {
-                    if (audio.connecttoFS(SD, trackPath.c_str())) {
-                        Serial.println("[Task_Media] Track connected successfully.");
-                        isPlaying = true;
-                        isStoped = false;
-                    } else {
-                        Serial.println("ERROR: Failed to connect track to codec.");
-                        isPlaying = false;
-                        isStoped = true;
-                    }
-                } else {
-                    Serial.println("WARNING: Codec not initialized, cannot play track.");
-                    isPlaying = false;
-                    isStoped = true;
-                }
-            } else {
-                Serial.println("ERROR: Track file not found on SD.");
-                isPlaying = false;
-                isStoped = true;
-            }
-            nextTrackRequest = false;
-        }
+        unsigned long busyStart = micros();
+        uint32_t blockedStart = audioOutputBlockedUs();
+        uint32_t framesStart = audioOutputFramesWritten();
+        profilerWakeup(PROF_TASK_AUDIO);
+        while (playerCommands.pop(cmd)) handlePlayerCommand(cmd);
+        logAmpSwitch();
 
-        if (currentUIState == UI_PLAYER && isPlaying && codec_initialized && !isStoped && fileCount > 0) {
+        if (trackLoaded && !trackPaused) {
+            profilerAudioTick();
             audio.loop();
+            applyPendingSeek();
+
+            bool dry = audio.isRunning() && audio.inBufferFilled() == 0;
+            if (dry && !inputDry) profilerUnderrun();
+            inputDry = dry;
 
-            if (!audio.isRunning()) {
-                Serial.printf("[Task_Media] Track %d ended, auto-advancing.\n", currentFileIndex);
-                currentFileIndex++;
-                if (currentFileIndex >= fileCount) currentFileIndex = 0;
-                nextTrackRequest = true;
+            if (trackEnded || !audio.isRunning()) {
+                Serial.printf("[Task_Media] Track %lu ended.\n", (unsigned long)trackIndex);
+                timeStretchFlush(writeOutput);
+                if (trackEnded) waveformCaptureEnd();
+                else waveformCaptureAbort();
+                trackLoaded = false;
+                postPlayerEvent(EVT_TRACK_ENDED, trackIndex);
+            } else if (pausePending) {
+                // The fade-out completes inside the decoder's next write; if the
+                // decoder is starved, don't wait for it.
+                if (!audioOutputPaused() && millis() - pauseRequestedMs >= pauseFadeTimeout) audioOutputForcePause();
+                if (audioOutputPaused()) {
+                    pausePending = false;
+                    trackPaused = true;
+                    postPlayerEvent(EVT_PAUSED, trackIndex, playPositionMs());
+                }
+            } else if (millis() - lastPosition >= positionInterval) {
+                postPlayerEvent(EVT_POSITION, trackIndex, playPositionMs());
+                lastPosition = millis();
             }
 
             if (millis() - lastLog >= 5000) {
-                Serial.printf("[Task_Media] Playing %d/%d, volume=%d, elapsed=%lu ms\n",
-                              currentFileIndex + 1, fileCount, volume, millis() - trackStartMillis);
+                Serial.printf("[Task_Media] Playing %lu, elapsed=%lu s\n",
+                              (unsigned long)trackIndex, (unsigned long)audio.getAudioCurrentTime());
                 lastLog = millis();
             }
-            vTaskDelay(playDelay);
+            profilerAddBusy(PROF_TASK_AUDIO, (micros() - busyStart) - (audioOutputBlockedUs() - blockedStart));
+            if (audioOutputFramesWritten() == framesStart) vTaskDelay(playDelay);
+        } else if (diagActive) {
+            renderDiagnostics();
+            profilerAddBusy(PROF_TASK_AUDIO, (micros() - busyStart) - (audioOutputBlockedUs() - blockedStart));
         } else {
-            vTaskDelay(idleDelay);
+            audioOutputIdle();
+            if (trackPaused && millis() - lastLog >= 5000) {
+                const ProfilerSnapshot &ps = getProfilerSnapshot();
+                Serial.printf("[Task_Media] Paused, wakeups/s UI=%u AU=%u, stretch dropped %lu\n",
+                              ps.wakeups[PROF_TASK_UI], ps.wakeups[PROF_TASK_AUDIO],
+                              (unsigned long)timeStretchDroppedFrames());
+                lastLog = millis();
+            }
+            profilerAddBusy(PROF_TASK_AUDIO, micros() - busyStart);
+            ulTaskNotifyTake(pdTRUE, idleDelay);
         }
     }
 }
 
+// Decoded PCM (interleaved 16-bit stereo) is routed to our own I2S output
+// instead of the library's driver; the blocking write paces Task_Audio.
+void audio_process_i2s(int16_t *outBuff, uint16_t validSamples, uint8_t, uint8_t, bool *continueI2S) {
+    *continueI2S = false;
+    if (decodeBenchActive()) {
+        decodeBenchOnFrame(validSamples);
+        return;
+    }
+    uint32_t rate = audio.getSampleRate();
+    if (rate != audioOutputSampleRate()) audioOutputSetSampleRate(rate);
+    if (pendingSeekMs != 0) {
+        pendingSeekDecoded = true;
+        return;
+    }
+    waveformCaptureFrames(outBuff, validSamples);
+    timeStretchProcess(outBuff, validSamples, writeOutput);
+    if (skipIssuedUs != 0) {
+        profilerLatency(PROF_LAT_SKIP_TO_AUDIO, micros() - skipIssuedUs);
+        skipIssuedUs = 0;
+    }
+}
+
 void audio_eof_mp3(const char *info) {
     Serial.printf("eof_mp3: %s\n", info);
-    if (currentUIState == UI_PLAYER && fileCount > 0) {
-        currentFileIndex++;
-        if (currentFileIndex >= fileCount) currentFileIndex = 0;
-        Serial.printf("Auto-advancing to next: %s\n", audioFiles[currentFileIndex].c_str());
-        nextTrackRequest = true;
-    }
+    trackEnded = true;
 }
@@ -0,0 +1,96 @@
+#include "playback_state.h"
+#include <Preferences.h>
+
+constexpr uint16_t STATE_VERSION = 1;
+constexpr uint32_t POSITION_SLACK_MS = 2000;
+
+struct StoredState {
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t index;
+    uint32_t positionMs;
+    uint32_t folderMtime;
+    char folder[PLAYBACK_FOLDER_MAX];
+    char track[PLAYBACK_TRACK_MAX];
+};
+
+static Preferences statePrefs;
+static Preferences bookmarkPrefs;
+static StoredState saved = {};
+static unsigned long lastSaveMs = 0;
+static bool ready = false;
+
+// NVS keys are limited to 15 characters, so bookmarks are keyed by a hash
+// of the full track path.
+static String bookmarkKey(const String &path) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < path.length(); i++) {
+        hash ^= (uint8_t)path[i];
+        hash *= 16777619UL;
+    }
+    char key[12];
+    snprintf(key, sizeof(key), "b%08lx", (unsigned long)hash);
+    return String(key);
+}
+
+void initPlaybackState() {
+    ready = statePrefs.begin("player", false) && bookmarkPrefs.begin("bookmarks", false);
+    if (!ready) {
+        Serial.println("ERROR: NVS unavailable, playback state won't persist");
+        return;
+    }
+    if (statePrefs.getBytes("state", &saved, sizeof(saved)) != sizeof(saved) || saved.version != STATE_VERSION) {
+        memset(&saved, 0, sizeof(saved));
+    }
+}
+
+bool loadPlaybackState(PlaybackState &state) {
+    if (!ready || saved.version != STATE_VERSION || saved.folder[0] == '\0') return false;
+    state.folder = saved.folder;
+    state.track = saved.track;
+    state.index = saved.index;
+    state.positionMs = saved.positionMs;
+    state.folderMtime = saved.folderMtime;
+    return true;
+}
+
+// Throttled: position-only changes are written at most every
+// PLAYBACK_SAVE_INTERVAL_MS unless forced (pause, stop, track change).
+void updatePlaybackState(const PlaybackState &state, bool force) {
+    if (!ready) return;
+
+    bool sameTrack = saved.version == STATE_VERSION && saved.index == state.index &&
+                     state.folder == saved.folder && state.track == saved.track;
+    uint32_t drift = (state.positionMs > saved.positionMs) ? state.positionMs - saved.positionMs
+                                                           : saved.positionMs - state.positionMs;
+    if (sameTrack && drift < POSITION_SLACK_MS && saved.folderMtime == state.folderMtime) return;
+    if (sameTrack && !force && millis() - lastSaveMs < PLAYBACK_SAVE_INTERVAL_MS) return;
+
+    StoredState next = {};
+    next.version = STATE_VERSION;
+    next.index = state.index;
+    next.positionMs = state.positionMs;
+    next.folderMtime = state.folderMtime;
+    strlcpy(next.folder, state.folder.c_str(), sizeof(next.folder));
+    strlcpy(next.track, state.track.c_str(), sizeof(next.track));
+
+    if (statePrefs.putBytes("state", &next, sizeof(next)) == sizeof(next)) {
+        saved = next;
+        lastSaveMs = millis();
+    }
+}
+
+bool saveBookmark(const String &path, uint32_t positionMs) {
+    if (!ready) return false;
+    bool ok = bookmarkPrefs.putUInt(bookmarkKey(path).c_str(), positionMs) == sizeof(uint32_t);
+    Serial.printf("Bookmark %s at %lu ms %s\n", path.c_str(), (unsigned long)positionMs, ok ? "saved" : "FAILED");
+    return ok;
+}
+
+bool loadBookmark(const String &path, uint32_t &positionMs) {
+    if (!ready) return false;
+    String key = bookmarkKey(path);
+    if (!bookmarkPrefs.isKey(key.c_str())) return false;
+    positionMs = bookmarkPrefs.getUInt(key.c_str(), 0);
+    return true;
+}
@@ -0,0 +1,78 @@
+#include "player_control.h"
+#include "frame_scheduler.h"
+
+SpscQueue<PlayerCommand, 8> playerCommands;
+SpscQueue<PlayerEvent, 32> playerEvents;
+
+static TaskHandle_t audioTaskHandle = NULL;
+static uint32_t commandOriginUs = 0;
+static uint32_t playGeneration = 0;  // Task_TFT only
+static uint32_t eventGeneration = 0; // Task_Audio only
+
+void initPlayerControl(TaskHandle_t audioTask) {
+    audioTaskHandle = audioTask;
+}
+
+void setCommandOrigin(uint32_t timestampUs) {
+    commandOriginUs = timestampUs;
+}
+
+static bool enqueueCommand(PlayerCommand& cmd) {
+    cmd.originUs = commandOriginUs;
+    cmd.generation = playGeneration + (cmd.type == CMD_PLAY ? 1 : 0);
+    cmd.issuedUs = micros();
+    if (!playerCommands.push(cmd)) {
+        Serial.printf("WARNING: player command queue full, dropped cmd %d\n", cmd.type);
+        return false;
+    }
+    playGeneration = cmd.generation;
+    if (audioTaskHandle) xTaskNotifyGive(audioTaskHandle);
+    return true;
+}
+
+bool sendPlayerCommand(PlayerCommandType type, int32_t value) {
+    PlayerCommand cmd;
+    cmd.type = type;
+    cmd.trackIndex = 0;
+    cmd.value = value;
+    cmd.path[0] = '\0';
+    return enqueueCommand(cmd);
+}
+
+bool sendPlayTrack(uint32_t index, const String& path, uint32_t startMs) {
+    if (path.length() >= PLAYER_PATH_MAX) {
+        Serial.printf("ERROR: track path too long: %s\n", path.c_str());
+        return false;
+    }
+    PlayerCommand cmd;
+    cmd.type = CMD_PLAY;
+    cmd.trackIndex = index;
+    cmd.value = startMs;
+    strlcpy(cmd.path, path.c_str(), sizeof(cmd.path));
+    return enqueueCommand(cmd);
+}
+
+bool sendDecodeBenchmark(const String& folder) {
+    if (folder.length() >= PLAYER_PATH_MAX) return false;
+    PlayerCommand cmd;
+    cmd.type = CMD_BENCHMARK;
+    cmd.trackIndex = 0;
+    cmd.value = 0;
+    strlcpy(cmd.path, folder.c_str(), sizeof(cmd.path));
+    return enqueueCommand(cmd);
+}
+
+bool postPlayerEvent(PlayerEventType type, uint32_t trackIndex, uint32_t value) {
+    PlayerEvent evt = {type, trackIndex, value, eventGeneration};
+    if (!playerEvents.push(evt)) return false;
+    requestRedraw(REDRAW_STATE);
+    return true;
+}
+
+uint32_t currentPlayGeneration() {
+    return playGeneration;
+}
+
+void beginPlayGeneration(uint32_t generation) {
+    eventGeneration = generation;
+}
@@ -0,0 +1,78 @@
+#include "power_governor.h"
+#include "profiler.h"
+
+constexpr uint16_t GOV_LEVELS_MHZ[] = {80, 160, 240};
+constexpr uint8_t GOV_LEVEL_COUNT = sizeof(GOV_LEVELS_MHZ) / sizeof(GOV_LEVELS_MHZ[0]);
+constexpr uint8_t GOV_UP_PCT = 70;
+constexpr uint8_t GOV_DOWN_PCT = 50;
+constexpr uint8_t GOV_DOWN_HOLD_WINDOWS = 5;
+constexpr uint8_t GOV_BOOST_WINDOWS = 2;
+
+static uint8_t level = GOV_LEVEL_COUNT - 1;
+static uint8_t downHold = 0;
+static uint8_t boostWindows = 0;
+static PowerStats stats = {GOV_LEVELS_MHZ[GOV_LEVEL_COUNT - 1], 0};
+
+// Frequency scaling only. Light sleep between DMA buffers would need an
+// IDF build with CONFIG_PM_ENABLE and tickless idle, plus PM locks around
+// the I2S and SD work; the stock Arduino core has neither.
+static void applyLevel() {
+    uint16_t mhz = GOV_LEVELS_MHZ[level];
+    if (mhz == stats.cpuMhz) return;
+
+    setCpuFrequencyMhz(mhz);
+    Serial.printf("[Power] CPU %u MHz\n", mhz);
+    stats.cpuMhz = mhz;
+}
+
+void initPowerGovernor() {
+    level = GOV_LEVEL_COUNT - 1;
+    stats.cpuMhz = getCpuFrequencyMhz();
+    applyLevel();
+}
+
+// Takes effect right away rather than at the next profiler window, so a
+// track start never decodes its first frames at the idle clock.
+void powerGovernorBoost() {
+    boostWindows = GOV_BOOST_WINDOWS;
+    level = GOV_LEVEL_COUNT - 1;
+    downHold = 0;
+    applyLevel();
+}
+
+void powerGovernorUpdate() {
+    const ProfilerSnapshot &ps = getProfilerSnapshot();
+    uint8_t busy = max(ps.cpuPct[PROF_TASK_UI], ps.cpuPct[PROF_TASK_AUDIO]);
+    stats.busyPct = busy;
+
+    if (boostWindows > 0) {
+        boostWindows--;
+        level = GOV_LEVEL_COUNT - 1;
+        downHold = 0;
+    } else if (busy > GOV_UP_PCT && level < GOV_LEVEL_COUNT - 1) {
+        level++;
+        downHold = 0;
+    } else if (level > 0) {
+        uint32_t projected = (uint32_t)busy * GOV_LEVELS_MHZ[level] / GOV_LEVELS_MHZ[level - 1];
+        if (projected < GOV_DOWN_PCT) {
+            if (++downHold >= GOV_DOWN_HOLD_WINDOWS) {
+                level--;
+                downHold = 0;
+            }
+        } else {
+            downHold = 0;
+        }
+    }
+
+    applyLevel();
+
+    if (profilerStreamEnabled) {
+        Serial.printf("$PWR,%lu,%u,%u,%u,%u,%u\n", (unsigned long)ps.timestampMs, stats.cpuMhz,
+                      ps.cpuPct[PROF_TASK_UI], ps.cpuPct[PROF_TASK_AUDIO],
+                      ps.wakeups[PROF_TASK_UI], ps.wakeups[PROF_TASK_AUDIO]);
+    }
+}
+
+PowerStats getPowerStats() {
+    return stats;
+}
@@ -0,0 +1,157 @@
+#include "profiler.h"
+#include "frame_scheduler.h"
+#include "audio_output.h"
+#include "esp_heap_caps.h"
+
+constexpr unsigned long PROFILER_WINDOW_MS = 1000;
+
+bool profilerHudVisible = false;
+bool profilerStreamEnabled = false;
+
+static TaskHandle_t taskHandles[PROF_TASK_COUNT] = {NULL};
+static volatile uint32_t busyUs[PROF_TASK_COUNT] = {0};
+static uint32_t lastBusyUs[PROF_TASK_COUNT] = {0};
+static volatile uint32_t wakeCount[PROF_TASK_COUNT] = {0};
+static uint32_t lastWakeCount[PROF_TASK_COUNT] = {0};
+
+static volatile uint32_t audioTicks = 0;
+static volatile uint32_t audioPeriodSumUs = 0;
+static volatile uint32_t audioPeriodMaxUs = 0;
+static uint32_t audioLastTickUs = 0;
+static uint32_t lastAudioTicks = 0;
+static uint32_t lastAudioPeriodSumUs = 0;
+
+static volatile uint32_t underrunCount = 0;
+
+static uint32_t pushSumUs = 0;
+static uint32_t pushFrames = 0;
+
+static uint32_t latencyLastUs[PROF_LAT_COUNT] = {0};
+static uint32_t latencyMaxUs[PROF_LAT_COUNT] = {0};
+static uint64_t latencySumUs[PROF_LAT_COUNT] = {0};
+static volatile uint32_t latencySamples[PROF_LAT_COUNT] = {0};
+
+static ProfilerSnapshot snapshot = {};
+static unsigned long windowStart = 0;
+
+void profilerRegisterTask(ProfTask task, TaskHandle_t handle) {
+    taskHandles[task] = handle;
+}
+
+void profilerAddBusy(ProfTask task, uint32_t us) {
+    busyUs[task] += us;
+}
+
+void profilerWakeup(ProfTask task) {
+    wakeCount[task]++;
+}
+
+void profilerAudioTick() {
+    uint32_t now = micros();
+    if (audioLastTickUs != 0) {
+        uint32_t period = now - audioLastTickUs;
+        audioPeriodSumUs += period;
+        audioTicks++;
+        if (period > audioPeriodMaxUs) audioPeriodMaxUs = period;
+    }
+    audioLastTickUs = now;
+}
+
+void profilerUnderrun() {
+    underrunCount++;
+}
+
+void profilerFramePushed(uint32_t us) {
+    pushSumUs += us;
+    pushFrames++;
+}
+
+void profilerLatency(ProfLatency kind, uint32_t us) {
+    latencyLastUs[kind] = us;
+    latencySumUs[kind] += us;
+    if (us > latencyMaxUs[kind]) latencyMaxUs[kind] = us;
+    latencySamples[kind]++;
+}
+
+static void streamSnapshot() {
+    Serial.printf("$PRF,%lu,%u,%lu,%lu,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                  (unsigned long)snapshot.timestampMs, snapshot.fpsX10,
+                  (unsigned long)snapshot.renderUs, (unsigned long)snapshot.pushUs,
+                  snapshot.cpuPct[PROF_TASK_UI], snapshot.cpuPct[PROF_TASK_AUDIO],
+                  (unsigned long)snapshot.stackFree[PROF_TASK_UI], (unsigned long)snapshot.stackFree[PROF_TASK_AUDIO],
+                  (unsigned long)snapshot.audioPeriodAvgUs, (unsigned long)snapshot.audioPeriodMaxUs,
+                  (unsigned long)snapshot.underruns,
+                  (unsigned long)snapshot.heapFree, (unsigned long)snapshot.heapLargest);
+
+    const LatencyStats &ka = snapshot.latency[PROF_LAT_KEY_TO_AUDIO];
+    const LatencyStats &kp = snapshot.latency[PROF_LAT_KEY_TO_PIXELS];
+    const LatencyStats &ks = snapshot.latency[PROF_LAT_KEY_TO_SILENCE];
+    const LatencyStats &sk = snapshot.latency[PROF_LAT_SKIP_TO_AUDIO];
+    Serial.printf("$LAT,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                  (unsigned long)snapshot.timestampMs,
+                  (unsigned long)ka.lastUs, (unsigned long)ka.avgUs, (unsigned long)ka.maxUs, (unsigned long)ka.samples,
+                  (unsigned long)kp.lastUs, (unsigned long)kp.avgUs, (unsigned long)kp.maxUs, (unsigned long)kp.samples,
+                  (unsigned long)ks.lastUs, (unsigned long)ks.avgUs, (unsigned long)ks.maxUs, (unsigned long)ks.samples,
+                  (unsigned long)sk.lastUs, (unsigned long)sk.avgUs, (unsigned long)sk.maxUs, (unsigned long)sk.samples);
+
+    AudioOutputStats ao = getAudioOutputStats();
+    Serial.printf("$DMA,%lu,%u,%u,%lu,%lu,%lu,%lu,%lu\n",
+                  (unsigned long)snapshot.timestampMs, ao.dmaCount, ao.dmaLen,
+                  (unsigned long)ao.sampleRate, (unsigned long)ao.underruns, (unsigned long)ao.reconfigs,
+                  (unsigned long)ao.latencyUs, (unsigned long)ao.capacityUs);
+}
+
+bool profilerUpdate() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - windowStart;
+    if (elapsed < PROFILER_WINDOW_MS) return false;
+
+    uint32_t windowUs = elapsed * 1000UL;
+    for (int t = 0; t < PROF_TASK_COUNT; t++) {
+        uint32_t busy = busyUs[t];
+        uint32_t delta = busy - lastBusyUs[t];
+        lastBusyUs[t] = busy;
+        snapshot.cpuPct[t] = (uint8_t)min<uint32_t>(100, (uint64_t)delta * 100 / windowUs);
+        snapshot.stackFree[t] = taskHandles[t] ? uxTaskGetStackHighWaterMark(taskHandles[t]) : 0;
+
+        uint32_t wakes = wakeCount[t];
+        snapshot.wakeups[t] = (uint16_t)min<uint32_t>(UINT16_MAX, (uint64_t)(wakes - lastWakeCount[t]) * 1000 / elapsed);
+        lastWakeCount[t] = wakes;
+    }
+
+    uint32_t ticks = audioTicks;
+    uint32_t periodSum = audioPeriodSumUs;
+    uint32_t tickDelta = ticks - lastAudioTicks;
+    snapshot.audioPeriodAvgUs = tickDelta ? (periodSum - lastAudioPeriodSumUs) / tickDelta : 0;
+    snapshot.audioPeriodMaxUs = audioPeriodMaxUs;
+    audioPeriodMaxUs = 0;
+    lastAudioTicks = ticks;
+    lastAudioPeriodSumUs = periodSum;
+
+    FrameStats fs = getFrameStats();
+    snapshot.fpsX10 = fs.fpsX10;
+    snapshot.renderUs = fs.avgFrameUs;
+    snapshot.pushUs = pushFrames ? pushSumUs / pushFrames : 0;
+    pushSumUs = 0;
+    pushFrames = 0;
+
+    snapshot.underruns = underrunCount;
+    snapshot.heapFree = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    snapshot.heapLargest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    for (int k = 0; k < PROF_LAT_COUNT; k++) {
+        uint32_t samples = latencySamples[k];
+        snapshot.latency[k].samples = samples;
+        snapshot.latency[k].lastUs = latencyLastUs[k];
+        snapshot.latency[k].maxUs = latencyMaxUs[k];
+        snapshot.latency[k].avgUs = samples ? (uint32_t)(latencySumUs[k] / samples) : 0;
+    }
+    snapshot.timestampMs = now;
+    windowStart = now;
+
+    if (profilerStreamEnabled) streamSnapshot();
+    return true;
+}
+
+const ProfilerSnapshot& getProfilerSnapshot() {
+    return snapshot;
+}
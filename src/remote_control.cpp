@@ -0,0 +1,212 @@
+#include "remote_control.h"
+#include "ui_manager.h"
+#include "input_manager.h"
+#include "file_manager.h"
+#include "player_control.h"
+#include "profiler.h"
+#include "audio_output.h"
+#include "frame_scheduler.h"
+#include "decode_bench.h"
+#include "signal_gen.h"
+#include "decode_cost.h"
+
+static uint8_t frame[4 + REMOTE_MAX_PAYLOAD + 2];
+static uint16_t frameLen = 0;
+static unsigned long frameStartMs = 0;
+static char line[64];
+static uint8_t lineLen = 0;
+static unsigned long lastFrameMs = 0;
+static bool everActive = false;
+
+static uint16_t crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+// Replies are built in place and written with a single call, so log lines
+// from other tasks can't land inside a frame.
+class Reply {
+public:
+    Reply(uint8_t seq, uint8_t type) {
+        buf[0] = REMOTE_STX;
+        buf[2] = seq;
+        buf[3] = type;
+    }
+    void u8(uint8_t v) { if (len < REMOTE_MAX_PAYLOAD) buf[4 + len++] = v; }
+    void u16(uint16_t v) { u8(v & 0xFF); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+    void str(const String &s) {
+        uint8_t n = min((size_t)s.length(), (size_t)64);
+        u8(n);
+        for (uint8_t i = 0; i < n; i++) u8(s[i]);
+    }
+    void send() {
+        buf[1] = len;
+        uint16_t crc = crc16(buf + 1, len + 3);
+        buf[4 + len] = crc & 0xFF;
+        buf[5 + len] = crc >> 8;
+        Serial.write(buf, len + 6);
+    }
+
+private:
+    uint8_t buf[4 + REMOTE_MAX_PAYLOAD + 2];
+    uint8_t len = 0;
+};
+
+static void sendStatus(uint8_t seq, uint8_t type, uint8_t status) {
+    Reply r(seq, type);
+    r.u8(status);
+    r.send();
+}
+
+static int32_t readI32(const uint8_t *p) {
+    return (int32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static void sendState(uint8_t seq) {
+    PlayerSnapshot snap;
+    getPlayerSnapshot(snap);
+    Reply r(seq, REMOTE_GET_STATE | REMOTE_REPLY);
+    r.u8(snap.uiState);
+    r.u8((snap.playing ? 1 : 0) | (snap.stopped ? 2 : 0) | (snap.screenDimmed ? 4 : 0));
+    r.u32(snap.fileCount);
+    r.u32(snap.trackIndex);
+    r.u32(snap.positionMs);
+    r.u32(snap.durationMs);
+    r.u8(snap.volume);
+    r.u8(snap.brightness);
+    r.u32(millis());
+    r.str(snap.folder);
+    r.str(snap.track);
+    r.send();
+}
+
+// A count followed by that many u32s, in an order tools/remote.py names;
+// new counters are only ever appended.
+static void sendCounters(uint8_t seq) {
+    const ProfilerSnapshot &ps = getProfilerSnapshot();
+    AudioOutputStats ao = getAudioOutputStats();
+    DirCacheStats dc = getDirCacheStats();
+    FrameStats fs = getFrameStats();
+    const LatencyStats &ka = ps.latency[PROF_LAT_KEY_TO_AUDIO];
+    const LatencyStats &kp = ps.latency[PROF_LAT_KEY_TO_PIXELS];
+    const LatencyStats &sk = ps.latency[PROF_LAT_SKIP_TO_AUDIO];
+    const uint32_t values[] = {
+        (uint32_t)millis(), ps.fpsX10, ps.renderUs, ps.pushUs, ps.cpuPct[PROF_TASK_UI], ps.cpuPct[PROF_TASK_AUDIO],
+        ps.audioPeriodMaxUs, ps.underruns, ps.heapFree, ps.heapLargest,
+        ka.lastUs, ka.avgUs, ka.maxUs, ka.samples,
+        kp.lastUs, kp.avgUs, kp.maxUs, kp.samples,
+        ao.underruns, ao.reconfigs, ao.dmaCount, ao.latencyUs,
+        dc.hits, dc.misses, fs.totalFrames, fs.maxFrameUs,
+        sk.lastUs, sk.avgUs, sk.maxUs, sk.samples, getPlayableCount()
+    };
+    Reply r(seq, REMOTE_GET_COUNTERS | REMOTE_REPLY);
+    r.u8(sizeof(values) / sizeof(values[0]));
+    for (uint32_t v : values) r.u32(v);
+    r.send();
+}
+
+static void handleFrame(uint8_t seq, uint8_t type, const uint8_t *payload, uint8_t len) {
+    uint8_t reply = type | REMOTE_REPLY;
+    switch (type) {
+    case REMOTE_PING: {
+        Reply r(seq, reply);
+        for (uint8_t i = 0; i < len; i++) r.u8(payload[i]);
+        r.send();
+        break;
+    }
+    case REMOTE_KEY:
+        if (len < 3) return sendStatus(seq, REMOTE_ERROR, REMOTE_BAD_FRAME);
+        sendStatus(seq, reply, injectInput(payload[0], payload[1] | (payload[2] << 8)) ? REMOTE_OK : REMOTE_REJECTED);
+        break;
+    case REMOTE_ACTION: {
+        if (len < 6 || len < 6 + payload[5]) return sendStatus(seq, REMOTE_ERROR, REMOTE_BAD_FRAME);
+        String path;
+        for (uint8_t i = 0; i < payload[5]; i++) path += (char)payload[6 + i];
+        setCommandOrigin(micros());
+        bool ok = handleRemoteAction(payload[0], readI32(payload + 1), path);
+        setCommandOrigin(0);
+        requestRedraw(REDRAW_INPUT);
+        sendStatus(seq, reply, ok ? REMOTE_OK : REMOTE_REJECTED);
+        break;
+    }
+    case REMOTE_GET_STATE:
+        sendState(seq);
+        break;
+    case REMOTE_GET_COUNTERS:
+        sendCounters(seq);
+        break;
+    default:
+        sendStatus(seq, REMOTE_ERROR, REMOTE_UNKNOWN);
+        break;
+    }
+}
+
+// Console lines: "bench [folder]" runs the decoder benchmark (default
+// DECODE_BENCH_DIR) and "sdbench" the SD read benchmark on Task_Audio,
+// "sigbench" the signal generator kernels here, "costs" lists the measured
+// decode cost table.
+static void handleConsoleLine(const String &text) {
+    if (text == "bench" || text.startsWith("bench ")) {
+        String folder = text.length() > 6 ? text.substring(6) : String(DECODE_BENCH_DIR);
+        folder.trim();
+        if (!sendDecodeBenchmark(folder)) Serial.println("[Bench] could not queue benchmark");
+    } else if (text == "sdbench") {
+        if (!sendPlayerCommand(CMD_SD_BENCHMARK)) Serial.println("[SD] could not queue benchmark");
+    } else if (text == "sigbench") {
+        signalBenchmark(AUDIO_OUTPUT_DEFAULT_RATE);
+    } else if (text == "costs") {
+        printDecodeCosts();
+    } else {
+        Serial.printf("Unknown command: %s\n", text.c_str());
+    }
+}
+
+static void feedFrame(uint8_t c) {
+    frame[frameLen++] = c;
+    if (frameLen < 4) return;
+    uint8_t len = frame[1];
+    if (len > REMOTE_MAX_PAYLOAD) {
+        frameLen = 0;
+        return;
+    }
+    if (frameLen < len + 6) return;
+
+    uint16_t crc = frame[4 + len] | (frame[5 + len] << 8);
+    frameLen = 0;
+    if (crc != crc16(frame + 1, len + 3)) {
+        sendStatus(frame[2], REMOTE_ERROR, REMOTE_BAD_FRAME);
+        return;
+    }
+    lastFrameMs = millis();
+    everActive = true;
+    handleFrame(frame[2], frame[3], frame + 4, len);
+}
+
+void pollRemote() {
+    if (frameLen > 0 && millis() - frameStartMs > REMOTE_FRAME_TIMEOUT_MS) frameLen = 0;
+
+    int c;
+    while ((c = Serial.read()) >= 0) {
+        if (frameLen > 0) {
+            feedFrame(c);
+        } else if (c == REMOTE_STX) {
+            frameStartMs = millis();
+            feedFrame(c);
+        } else if (c == '\r' || c == '\n') {
+            line[lineLen] = '\0';
+            if (lineLen > 0) handleConsoleLine(String(line));
+            lineLen = 0;
+        } else if (lineLen < sizeof(line) - 1) {
+            line[lineLen++] = c;
+        }
+    }
+}
+
+uint32_t remotePollMs() {
+    return everActive && millis() - lastFrameMs < REMOTE_ACTIVE_MS ? REMOTE_POLL_MS : UINT32_MAX;
+}
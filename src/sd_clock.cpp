@@ -0,0 +1,212 @@
+#include "sd_clock.h"
+#include "file_manager.h"
+#include <Preferences.h>
+
+#define SD_PROBE_FILE INDEX_DIR "/sdprobe.bin"
+#define SD_BENCH_FILE INDEX_DIR "/sdbench.bin"
+
+constexpr size_t SD_PROBE_CHUNK = 8192;
+
+static uint32_t clockHz = 0;
+
+static uint32_t fnv1a(const uint8_t *data, size_t len, uint32_t hash = 2166136261UL) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+// Test files hold a position-derived pattern, so reads can be checked
+// without a reference copy.
+static void fillPattern(uint8_t *buf, uint32_t offset, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint32_t pos = offset + i;
+        buf[i] = (uint8_t)((pos * 37) ^ (pos >> 9));
+    }
+}
+
+static bool ensurePatternFile(const char *path, uint32_t size, uint8_t *buf, size_t bufLen) {
+    File f = SD.open(path, FILE_READ);
+    bool ok = f && f.size() == size;
+    if (f) f.close();
+    if (ok) return true;
+
+    if (!SD.exists(INDEX_DIR)) SD.mkdir(INDEX_DIR);
+    f = SD.open(path, FILE_WRITE);
+    if (!f) return false;
+    ok = true;
+    for (uint32_t off = 0; ok && off < size; off += bufLen) {
+        size_t n = min((uint32_t)bufLen, size - off);
+        fillPattern(buf, off, n);
+        ok = f.write(buf, n) == n;
+    }
+    f.close();
+    return ok;
+}
+
+static bool verifyPatternFile(const char *path, uint8_t *buf, size_t bufLen) {
+    File f = SD.open(path, FILE_READ);
+    if (!f) return false;
+    uint8_t expect[64];
+    bool ok = true;
+    for (uint32_t off = 0; ok && off < f.size(); off += bufLen) {
+        size_t n = f.read(buf, bufLen);
+        if (n == 0) {
+            ok = false;
+            break;
+        }
+        for (size_t i = 0; ok && i < n; i += sizeof(expect)) {
+            size_t m = min(sizeof(expect), n - i);
+            fillPattern(expect, off + i, m);
+            ok = memcmp(buf + i, expect, m) == 0;
+        }
+    }
+    f.close();
+    return ok;
+}
+
+// Single-sector raw reads spread over the whole card, hashed.
+static bool hashSectors(uint32_t &hash, uint8_t *sector) {
+    size_t sectors = SD.numSectors();
+    if (sectors < SD_PROBE_SECTORS) return false;
+    hash = 2166136261UL;
+    for (uint8_t i = 0; i < SD_PROBE_SECTORS; i++) {
+        if (!SD.readRAW(sector, i * (sectors / SD_PROBE_SECTORS))) return false;
+        hash = fnv1a(sector, 512, hash);
+    }
+    return true;
+}
+
+static bool remount(uint8_t csPin, uint32_t freq) {
+    SD.end();
+    return SD.begin(csPin, SPI, freq);
+}
+
+static bool verifyReads(uint32_t sectorHash, bool haveFile, uint8_t *buf) {
+    for (uint8_t pass = 0; pass < SD_PROBE_PASSES; pass++) {
+        uint32_t hash;
+        if (!hashSectors(hash, buf) || hash != sectorHash) return false;
+        if (haveFile && !verifyPatternFile(SD_PROBE_FILE, buf, SD_PROBE_CHUNK)) return false;
+    }
+    return true;
+}
+
+uint32_t sdMountTuned(uint8_t csPin) {
+    unsigned long start = millis();
+    if (!SD.begin(csPin, SPI, SD_FREQ_SAFE)) return 0;
+    clockHz = SD_FREQ_SAFE;
+
+    uint8_t *buf = (uint8_t *)malloc(SD_PROBE_CHUNK);
+    uint32_t sectorHash;
+    if (buf == NULL || !hashSectors(sectorHash, buf)) {
+        Serial.println("[SD] raw reads unavailable, staying at the safe clock");
+        free(buf);
+        return clockHz;
+    }
+
+    // The MBR carries the volume's disk signature and partition table,
+    // which together with the size is a good enough card identity.
+    uint32_t cardId = SD.readRAW(buf, 0) ? fnv1a(buf, 512) : 0;
+    uint64_t size = SD.cardSize();
+    cardId = fnv1a((const uint8_t *)&size, sizeof(size), cardId);
+    char key[12];
+    snprintf(key, sizeof(key), "f%08lx", (unsigned long)cardId);
+
+    bool haveFile = ensurePatternFile(SD_PROBE_FILE, SD_PROBE_FILE_BYTES, buf, SD_PROBE_CHUNK);
+    Preferences prefs;
+    bool nvs = prefs.begin("sdcard", false);
+    uint32_t cached = nvs ? prefs.getUInt(key, 0) : 0;
+
+    if (cached != 0 && remount(csPin, cached) && verifyReads(sectorHash, haveFile, buf)) {
+        clockHz = cached;
+        Serial.printf("[SD] card %08lx: cached %lu kHz verified in %lu ms\n",
+                      (unsigned long)cardId, (unsigned long)(clockHz / 1000), millis() - start);
+    } else {
+        uint32_t best = SD_FREQ_SAFE;
+        bool atBest = cached == 0;
+        for (uint32_t freq : SD_FREQ_STEPS) {
+            if (!remount(csPin, freq) || !verifyReads(sectorHash, haveFile, buf)) {
+                Serial.printf("[SD] %lu kHz failed verification\n", (unsigned long)(freq / 1000));
+                atBest = false;
+                break;
+            }
+            best = freq;
+            atBest = true;
+        }
+        if (!atBest && !remount(csPin, best)) {
+            best = SD_FREQ_SAFE;
+            remount(csPin, best);
+        }
+        clockHz = best;
+        if (nvs) prefs.putUInt(key, best);
+        Serial.printf("[SD] card %08lx: probed %lu kHz in %lu ms\n",
+                      (unsigned long)cardId, (unsigned long)(clockHz / 1000), millis() - start);
+    }
+
+    if (nvs) prefs.end();
+    free(buf);
+    return clockHz;
+}
+
+uint32_t sdClockHz() {
+    return clockHz;
+}
+
+// Sequential and random read throughput through the File API (the path
+// playback and scanning use), for each power-of-two block size. Runs on
+// Task_Audio with playback stopped; sdMutex is held per timed pass only, so
+// the UI can still reach the card in between.
+uint8_t sdBenchmark(SdBenchResult *results, uint8_t maxResults) {
+    uint8_t *buf = (uint8_t *)malloc(SD_BENCH_MAX_BLOCK);
+    if (buf == NULL) return 0;
+
+    uint8_t count = 0;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    bool ready = ensurePatternFile(SD_BENCH_FILE, SD_BENCH_FILE_BYTES, buf, SD_BENCH_MAX_BLOCK);
+    File f = ready ? SD.open(SD_BENCH_FILE, FILE_READ) : File();
+    xSemaphoreGive(sdMutex);
+
+    if (!ready) {
+        Serial.println("[SD] could not create " SD_BENCH_FILE);
+    } else {
+        uint32_t rng = 0x2545F491;
+        Serial.printf("[SD] benchmark at %lu kHz\n", (unsigned long)(clockHz / 1000));
+        for (uint32_t block = SD_BENCH_MIN_BLOCK; f && block <= SD_BENCH_MAX_BLOCK && count < maxResults; block *= 2) {
+            SdBenchResult &r = results[count++];
+            r.blockSize = block;
+
+            xSemaphoreTake(sdMutex, portMAX_DELAY);
+            f.seek(0);
+            uint32_t start = micros();
+            for (uint32_t off = 0; off < SD_BENCH_FILE_BYTES; off += block) f.read(buf, block);
+            uint32_t seqUs = micros() - start;
+            xSemaphoreGive(sdMutex);
+
+            uint32_t blocks = SD_BENCH_FILE_BYTES / block;
+            xSemaphoreTake(sdMutex, portMAX_DELAY);
+            start = micros();
+            for (uint16_t i = 0; i < SD_BENCH_RANDOM_READS; i++) {
+                rng = rng * 1664525UL + 1013904223UL;
+                f.seek((rng >> 8) % blocks * block);
+                f.read(buf, block);
+            }
+            uint32_t randUs = micros() - start;
+            xSemaphoreGive(sdMutex);
+
+            r.seqKBps = seqUs ? (uint32_t)((uint64_t)SD_BENCH_FILE_BYTES * 1000000ULL / 1024 / seqUs) : 0;
+            r.randKBps = randUs ? (uint32_t)((uint64_t)block * SD_BENCH_RANDOM_READS * 1000000ULL / 1024 / randUs) : 0;
+            r.randAvgUs = randUs / SD_BENCH_RANDOM_READS;
+            Serial.printf("[SD] %5lu B  seq %6lu KB/s  random %6lu KB/s (%lu us/read)\n",
+                          (unsigned long)r.blockSize, (unsigned long)r.seqKBps, (unsigned long)r.randKBps,
+                          (unsigned long)r.randAvgUs);
+            Serial.printf("$SDB,%lu,%lu,%lu,%lu,%lu\n", (unsigned long)clockHz, (unsigned long)r.blockSize,
+                          (unsigned long)r.seqKBps, (unsigned long)r.randKBps, (unsigned long)r.randAvgUs);
+        }
+    }
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    if (f) f.close();
+    xSemaphoreGive(sdMutex);
+    free(buf);
+    return count;
+}
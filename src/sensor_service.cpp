@@ -0,0 +1,87 @@
+#include "sensor_service.h"
+#include "M5Cardputer.h"
+#include "audio_config.h"
+#include "freertos/timers.h"
+
+constexpr uint32_t HP_DEBOUNCE_MS = 30;
+constexpr uint32_t BATTERY_PERIOD_MS = 5000;
+constexpr uint8_t MAX_SUBSCRIBERS = 4;
+constexpr uint8_t BATTERY_SMOOTH_SHIFT = 2;
+
+static SensorCallback subscribers[MAX_SUBSCRIBERS] = {NULL};
+static volatile uint8_t subscriberCount = 0;
+static portMUX_TYPE subscriberMux = portMUX_INITIALIZER_UNLOCKED;
+
+static TimerHandle_t debounceTimer = NULL;
+static TimerHandle_t batteryTimer = NULL;
+
+static volatile bool hpInserted = false;
+static volatile uint8_t batteryPct = 0;
+static int32_t batterySmoothX16 = -1;
+
+static void notifySubscribers(SensorId id, int32_t value) {
+    for (uint8_t i = 0; i < subscriberCount; i++) subscribers[i](id, value);
+}
+
+static void IRAM_ATTR headphoneIsr() {
+    BaseType_t woken = pdFALSE;
+    xTimerResetFromISR(debounceTimer, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+static void debounceExpired(TimerHandle_t) {
+    bool inserted = (digitalRead(CARDPUTER_HP_DET_PIN) == LOW);
+    if (inserted == hpInserted) return;
+    hpInserted = inserted;
+    notifySubscribers(SENSOR_HEADPHONES, inserted);
+}
+
+static void sampleBattery(TimerHandle_t) {
+    int32_t level = constrain(M5Cardputer.Power.getBatteryLevel(), 0, 100);
+    if (batterySmoothX16 < 0) {
+        batterySmoothX16 = level << 4;
+    } else {
+        batterySmoothX16 += ((level << 4) - batterySmoothX16) >> BATTERY_SMOOTH_SHIFT;
+    }
+
+    uint8_t pct = (uint8_t)((batterySmoothX16 + 8) >> 4);
+    if (pct == batteryPct) return;
+    batteryPct = pct;
+    notifySubscribers(SENSOR_BATTERY, pct);
+}
+
+void initSensors() {
+    pinMode(CARDPUTER_HP_DET_PIN, INPUT_PULLUP);
+    hpInserted = (digitalRead(CARDPUTER_HP_DET_PIN) == LOW);
+    sampleBattery(NULL);
+
+    debounceTimer = xTimerCreate("hp_debounce", pdMS_TO_TICKS(HP_DEBOUNCE_MS), pdFALSE, NULL, debounceExpired);
+    batteryTimer = xTimerCreate("battery", pdMS_TO_TICKS(BATTERY_PERIOD_MS), pdTRUE, NULL, sampleBattery);
+    xTimerStart(batteryTimer, 0);
+    attachInterrupt(digitalPinToInterrupt(CARDPUTER_HP_DET_PIN), headphoneIsr, CHANGE);
+
+    Serial.printf("Sensors: headphones %s, battery %u%%\n", hpInserted ? "in" : "out", batteryPct);
+}
+
+// Task_TFT and Task_Audio subscribe concurrently from their init code; the
+// slot is filled before the count covers it, so the timer task never calls
+// an empty one.
+bool sensorSubscribe(SensorCallback cb) {
+    bool ok = false;
+    portENTER_CRITICAL(&subscriberMux);
+    if (subscriberCount < MAX_SUBSCRIBERS) {
+        subscribers[subscriberCount] = cb;
+        subscriberCount = subscriberCount + 1;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&subscriberMux);
+    return ok;
+}
+
+bool headphonesInserted() {
+    return hpInserted;
+}
+
+uint8_t batteryLevel() {
+    return batteryPct;
+}
@@ -0,0 +1,167 @@
+#include "signal_gen.h"
+#include "audio_output.h"
+#include <math.h>
+
+constexpr int SIG_TABLE_BITS = 10;
+constexpr uint32_t SIG_TABLE_SIZE = 1 << SIG_TABLE_BITS;
+
+// One extra entry so interpolation never wraps the index.
+static int16_t sineTable[SIG_TABLE_SIZE + 1];
+static bool sineTableReady = false;
+
+static const char *const kSignalNames[SIG_COUNT] = {"sine", "sweep", "white", "pink", "clicks"};
+
+const char *signalName(SignalType type) {
+    return type < SIG_COUNT ? kSignalNames[type] : "off";
+}
+
+static void buildSineTable() {
+    for (uint32_t i = 0; i <= SIG_TABLE_SIZE; i++) {
+        sineTable[i] = (int16_t)lrintf(32767.0f * sinf(2.0f * (float)M_PI * i / SIG_TABLE_SIZE));
+    }
+    sineTableReady = true;
+}
+
+static inline int32_t sineAt(uint32_t phase) {
+    uint32_t idx = phase >> (32 - SIG_TABLE_BITS);
+    int32_t frac = (phase >> (16 - SIG_TABLE_BITS)) & 0xFFFF;
+    int32_t a = sineTable[idx];
+    return a + (((sineTable[idx + 1] - a) * frac) >> 16);
+}
+
+static inline uint32_t nextNoise(uint32_t &x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static inline void putFrame(int16_t *out, size_t i, int32_t s) {
+    out[2 * i] = (int16_t)s;
+    out[2 * i + 1] = (int16_t)s;
+}
+
+void signalStart(SignalGen &gen, SignalType type, uint32_t sampleRate, uint32_t freqHz, int16_t level) {
+    if (!sineTableReady) buildSineTable();
+    memset(&gen, 0, sizeof(gen));
+    gen.type = type;
+    gen.level = level;
+    gen.sampleRate = sampleRate;
+    gen.phaseInc = (uint32_t)(((uint64_t)freqHz << 32) / sampleRate);
+    gen.noise = 0x2545F491;
+    gen.clickPeriod = sampleRate * SIG_CLICK_PERIOD_MS / 1000;
+
+    if (type == SIG_SWEEP) {
+        // Logarithmic sweep: the phase increment is scaled by a constant
+        // ratio every SIG_SWEEP_STEP frames.
+        uint32_t top = min<uint32_t>(SIG_SWEEP_TO_HZ, sampleRate / 2 - 1);
+        gen.sweepStartInc = (uint32_t)(((uint64_t)SIG_SWEEP_FROM_HZ << 32) / sampleRate);
+        gen.sweepEndInc = (uint32_t)(((uint64_t)top << 32) / sampleRate);
+        double steps = (double)SIG_SWEEP_MS * sampleRate / 1000.0 / SIG_SWEEP_STEP;
+        gen.sweepRatioQ30 = (uint32_t)lrint(pow((double)top / SIG_SWEEP_FROM_HZ, 1.0 / steps) * (1 << 30));
+        gen.phaseInc = gen.sweepStartInc;
+    }
+}
+
+static void renderTone(SignalGen &gen, int16_t *out, size_t frames) {
+    uint32_t phase = gen.phase;
+    for (size_t i = 0; i < frames; i++) {
+        putFrame(out, i, (sineAt(phase) * gen.level) >> 15);
+        phase += gen.phaseInc;
+    }
+    gen.phase = phase;
+}
+
+static void renderSweep(SignalGen &gen, int16_t *out, size_t frames) {
+    for (size_t done = 0; done < frames; done += SIG_SWEEP_STEP) {
+        renderTone(gen, out + 2 * done, min(frames - done, SIG_SWEEP_STEP));
+        gen.phaseInc = (uint32_t)(((uint64_t)gen.phaseInc * gen.sweepRatioQ30) >> 30);
+        if (gen.phaseInc > gen.sweepEndInc) gen.phaseInc = gen.sweepStartInc;
+    }
+}
+
+static void renderWhite(SignalGen &gen, int16_t *out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        int32_t s = (int16_t)(nextNoise(gen.noise) >> 16);
+        putFrame(out, i, (s * gen.level) >> 15);
+    }
+}
+
+// Voss-McCartney: row k is redrawn every 2^k samples, so the sum falls off
+// at about 3 dB per octave. Rows are 14-bit, which puts the RMS close to
+// the white noise at the same level without the sum ever clipping.
+static void renderPink(SignalGen &gen, int16_t *out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        uint32_t row = __builtin_ctz(++gen.pinkCounter | (1u << SIG_PINK_ROWS));
+        if (row < SIG_PINK_ROWS) {
+            int32_t v = (int32_t)nextNoise(gen.noise) >> 18;
+            gen.pinkSum += v - gen.pinkRows[row];
+            gen.pinkRows[row] = v;
+        }
+        int32_t s = gen.pinkSum + ((int32_t)nextNoise(gen.noise) >> 18);
+        putFrame(out, i, (s * gen.level) >> 15);
+    }
+}
+
+static int32_t renderClicks(SignalGen &gen, int16_t *out, size_t frames) {
+    int32_t onset = -1;
+    int32_t peak = min<int32_t>(gen.level * 4, INT16_MAX);
+    for (size_t i = 0; i < frames; i++) {
+        if (gen.clickPos == 0) {
+            onset = i;
+            gen.clicks++;
+        }
+        putFrame(out, i, gen.clickPos < SIG_CLICK_FRAMES ? peak : 0);
+        if (++gen.clickPos >= gen.clickPeriod) gen.clickPos = 0;
+    }
+    return onset;
+}
+
+int32_t signalRender(SignalGen &gen, int16_t *out, size_t frames) {
+    switch (gen.type) {
+    case SIG_SINE: renderTone(gen, out, frames); break;
+    case SIG_SWEEP: renderSweep(gen, out, frames); break;
+    case SIG_WHITE: renderWhite(gen, out, frames); break;
+    case SIG_PINK: renderPink(gen, out, frames); break;
+    case SIG_CLICKS: return renderClicks(gen, out, frames);
+    default: memset(out, 0, frames * 2 * sizeof(int16_t)); break;
+    }
+    return -1;
+}
+
+void signalPlayTone(uint32_t freqHz, uint32_t durationMs, int16_t level) {
+    int16_t block[AUDIO_OUTPUT_DMA_LEN * 2];
+    SignalGen gen;
+    signalStart(gen, SIG_SINE, audioOutputSampleRate(), freqHz, level);
+
+    uint32_t remaining = (uint64_t)audioOutputSampleRate() * durationMs / 1000;
+    while (remaining > 0) {
+        size_t n = min<uint32_t>(remaining, AUDIO_OUTPUT_DMA_LEN);
+        signalRender(gen, block, n);
+        audioOutputWrite(block, n);
+        remaining -= n;
+    }
+    Serial.printf("[Signal] %lu Hz tone done\n", (unsigned long)freqHz);
+}
+
+void signalBenchmark(uint32_t frames) {
+    static int16_t block[AUDIO_OUTPUT_DMA_LEN * 2];
+    uint32_t blocks = max<uint32_t>(frames / AUDIO_OUTPUT_DMA_LEN, 1);
+
+    for (uint8_t t = 0; t < SIG_COUNT; t++) {
+        SignalGen gen;
+        signalStart(gen, (SignalType)t, AUDIO_OUTPUT_DEFAULT_RATE);
+        unsigned long startUs = micros();
+        uint32_t startCycles = ESP.getCycleCount();
+        for (uint32_t b = 0; b < blocks; b++) signalRender(gen, block, AUDIO_OUTPUT_DMA_LEN);
+        uint32_t cycles = ESP.getCycleCount() - startCycles;
+        uint32_t nsPerBlock = (uint64_t)(micros() - startUs) * 1000 / blocks;
+
+        uint32_t perFrameX100 = (uint64_t)cycles * 100 / (blocks * AUDIO_OUTPUT_DMA_LEN);
+        Serial.printf("[Signal] %-6s %4lu.%02lu cycles/frame  %lu ns/block\n", signalName((SignalType)t),
+                      (unsigned long)(perFrameX100 / 100), (unsigned long)(perFrameX100 % 100),
+                      (unsigned long)nsPerBlock);
+        Serial.printf("$SIG,%s,%lu,%lu\n", signalName((SignalType)t), (unsigned long)perFrameX100,
+                      (unsigned long)nsPerBlock);
+    }
+}
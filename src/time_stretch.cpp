@@ -0,0 +1,231 @@
+#include "time_stretch.h"
+#include "audio_output.h"
+#include "signal_gen.h"
+
+// Every sequence after the first emits SEQUENCE - OVERLAP frames and
+// consumes speed times that much input, which must already be buffered
+// along with the search window.
+static_assert(STRETCH_SEEK_FRAMES + STRETCH_SEQUENCE_FRAMES <= STRETCH_BUFFER_FRAMES, "search window must fit");
+static_assert((STRETCH_SEQUENCE_FRAMES - STRETCH_OVERLAP_FRAMES) * STRETCH_SPEED_MAX / 100 <=
+                  STRETCH_SEEK_FRAMES + STRETCH_SEQUENCE_FRAMES, "skip must stay inside the buffer");
+
+constexpr size_t STRETCH_READY_FRAMES = STRETCH_SEEK_FRAMES + STRETCH_SEQUENCE_FRAMES;
+constexpr size_t STRETCH_HOP_FRAMES = STRETCH_SEQUENCE_FRAMES - STRETCH_OVERLAP_FRAMES;
+constexpr size_t STRETCH_MATCH_POINTS = STRETCH_OVERLAP_FRAMES / 2;
+
+static int16_t inBuf[STRETCH_BUFFER_FRAMES * 2];
+static size_t inFrames = 0;
+static int16_t midBuf[STRETCH_OVERLAP_FRAMES * 2];
+static int16_t midMono[STRETCH_MATCH_POINTS];
+static int16_t fadeBuf[STRETCH_OVERLAP_FRAMES * 2];
+static bool haveMid = false;
+static int32_t midEnd = 0; // buffer index where the input after midBuf resumes
+static uint16_t speed = 100;
+static uint32_t skipRemainder = 0;
+// Output the sink refused (a pause hold that filled up); it goes out ahead
+// of anything new. Only what overflows this as well is lost.
+static int16_t carryBuf[STRETCH_CARRY_FRAMES * 2];
+static size_t carryFrames = 0;
+static uint32_t carryDropped = 0;
+
+static void clearSequences() {
+    inFrames = 0;
+    haveMid = false;
+    midEnd = 0;
+    skipRemainder = 0;
+}
+
+void timeStretchReset() {
+    clearSequences();
+    carryFrames = 0;
+}
+
+static bool drainCarry(StretchSink sink) {
+    if (carryFrames == 0) return true;
+    size_t sent = sink(carryBuf, carryFrames);
+    carryFrames -= sent;
+    memmove(carryBuf, carryBuf + 2 * sent, carryFrames * 2 * sizeof(int16_t));
+    return carryFrames == 0;
+}
+
+static void emit(StretchSink sink, const int16_t *frames, size_t frameCount) {
+    if (drainCarry(sink)) {
+        size_t sent = sink(frames, frameCount);
+        frames += 2 * sent;
+        frameCount -= sent;
+    }
+    size_t room = STRETCH_CARRY_FRAMES - carryFrames;
+    if (frameCount > room) {
+        carryDropped += frameCount - room;
+        frameCount = room;
+    }
+    memcpy(carryBuf + 2 * carryFrames, frames, frameCount * 2 * sizeof(int16_t));
+    carryFrames += frameCount;
+}
+
+uint16_t timeStretchSpeed() {
+    return speed;
+}
+
+void timeStretchSetSpeed(uint16_t percent, StretchSink sink) {
+    percent = constrain(percent, STRETCH_SPEED_MIN, STRETCH_SPEED_MAX);
+    if (percent == speed) return;
+    if (percent == 100) timeStretchFlush(sink);
+    speed = percent;
+}
+
+uint32_t timeStretchDroppedFrames() {
+    return carryDropped;
+}
+
+// Mono, every other frame: plenty to line up waveforms, and the products
+// of two halved sums stay inside 32 bits. The score is corr * |corr| / norm;
+// only a loud corr needs bits dropped for its square to fit in 64, and the
+// norm drops twice as many so every candidate stays on the same scale.
+static int64_t matchScore(const int16_t *candidate) {
+    int64_t corr = 0;
+    int64_t norm = 0;
+    for (size_t k = 0; k < STRETCH_MATCH_POINTS; k++) {
+        int32_t y = (candidate[4 * k] + candidate[4 * k + 1]) >> 1;
+        corr += midMono[k] * y;
+        norm += y * y;
+    }
+    int64_t mag = corr < 0 ? -corr : corr;
+    int shift = 0;
+    while ((mag >> shift) > INT32_MAX) shift++;
+    mag >>= shift;
+    int64_t score = mag * mag / ((norm >> (2 * shift)) + 1);
+    return corr < 0 ? -score : score;
+}
+
+static size_t bestOffset() {
+    for (size_t k = 0; k < STRETCH_MATCH_POINTS; k++) {
+        midMono[k] = (midBuf[4 * k] + midBuf[4 * k + 1]) >> 1;
+    }
+
+    size_t best = 0;
+    int64_t bestScore = INT64_MIN;
+    for (size_t o = 0; o < STRETCH_SEEK_FRAMES; o += STRETCH_SEEK_COARSE_STEP) {
+        int64_t score = matchScore(inBuf + 2 * o);
+        if (score > bestScore) {
+            bestScore = score;
+            best = o;
+        }
+    }
+    size_t from = best >= STRETCH_SEEK_COARSE_STEP ? best - STRETCH_SEEK_COARSE_STEP + 1 : 0;
+    size_t to = min(best + STRETCH_SEEK_COARSE_STEP, STRETCH_SEEK_FRAMES);
+    size_t coarse = best;
+    for (size_t o = from; o < to; o++) {
+        if (o == coarse) continue;
+        int64_t score = matchScore(inBuf + 2 * o);
+        if (score > bestScore) {
+            bestScore = score;
+            best = o;
+        }
+    }
+    return best;
+}
+
+static void stretchSequence(StretchSink sink) {
+    size_t offset = haveMid ? bestOffset() : 0;
+    const int16_t *seq = inBuf + 2 * offset;
+
+    if (haveMid) {
+        for (size_t i = 0; i < STRETCH_OVERLAP_FRAMES; i++) {
+            int32_t w = (int32_t)((i << 15) / STRETCH_OVERLAP_FRAMES);
+            for (size_t c = 0; c < 2; c++) {
+                fadeBuf[2 * i + c] = (midBuf[2 * i + c] * (32768 - w) + seq[2 * i + c] * w) >> 15;
+            }
+        }
+        emit(sink, fadeBuf, STRETCH_OVERLAP_FRAMES);
+        emit(sink, seq + 2 * STRETCH_OVERLAP_FRAMES, STRETCH_SEQUENCE_FRAMES - 2 * STRETCH_OVERLAP_FRAMES);
+    } else {
+        emit(sink, seq, STRETCH_HOP_FRAMES);
+    }
+    memcpy(midBuf, seq + 2 * STRETCH_HOP_FRAMES, sizeof(midBuf));
+    haveMid = true;
+
+    // Input advances by exactly speed x output over the long run, so the
+    // decoder's position stays the position of what is heard.
+    skipRemainder += speed * STRETCH_HOP_FRAMES;
+    size_t skip = skipRemainder / 100;
+    skipRemainder %= 100;
+    midEnd = (int32_t)(offset + STRETCH_SEQUENCE_FRAMES) - (int32_t)skip;
+    memmove(inBuf, inBuf + 2 * skip, (inFrames - skip) * 2 * sizeof(int16_t));
+    inFrames -= skip;
+}
+
+void timeStretchProcess(const int16_t *frames, size_t frameCount, StretchSink sink) {
+    if (speed == 100 && inFrames == 0 && !haveMid) {
+        emit(sink, frames, frameCount);
+        return;
+    }
+    while (frameCount > 0) {
+        size_t n = min(frameCount, STRETCH_BUFFER_FRAMES - inFrames);
+        memcpy(inBuf + 2 * inFrames, frames, n * 2 * sizeof(int16_t));
+        inFrames += n;
+        frames += 2 * n;
+        frameCount -= n;
+        while (inFrames >= STRETCH_READY_FRAMES) stretchSequence(sink);
+    }
+}
+
+void timeStretchFlush(StretchSink sink) {
+    if (haveMid) emit(sink, midBuf, STRETCH_OVERLAP_FRAMES);
+    size_t from = midEnd > 0 ? midEnd : 0;
+    if (from < inFrames) emit(sink, inBuf + 2 * from, inFrames - from);
+    clearSequences();
+}
+
+static uint64_t benchOutFrames = 0;
+
+static size_t countFrames(const int16_t *, size_t frameCount) {
+    benchOutFrames += frameCount;
+    return frameCount;
+}
+
+void timeStretchBenchmark(uint32_t seconds) {
+    constexpr size_t CHUNK = 1152; // one MP3 frame
+    static int16_t chunk[CHUNK * 2];
+    const uint32_t rate = AUDIO_OUTPUT_DEFAULT_RATE;
+    uint16_t saved = speed;
+
+    for (uint16_t s = STRETCH_SPEED_MIN; s <= STRETCH_SPEED_MAX; s += STRETCH_SPEED_STEP) {
+        SignalGen gen;
+        signalStart(gen, SIG_SWEEP, rate);
+        timeStretchReset();
+        speed = s;
+        benchOutFrames = 0;
+
+        uint64_t inTotal = (uint64_t)seconds * rate;
+        uint64_t busyUs = 0;
+        uint64_t cycles = 0;
+        for (uint64_t done = 0; done < inTotal; done += CHUNK) {
+            signalRender(gen, chunk, CHUNK);
+            unsigned long startUs = micros();
+            uint32_t startCycles = ESP.getCycleCount();
+            timeStretchProcess(chunk, CHUNK, countFrames);
+            cycles += ESP.getCycleCount() - startCycles;
+            busyUs += micros() - startUs;
+        }
+        uint64_t fed = (inTotal + CHUNK - 1) / CHUNK * CHUNK;
+        timeStretchFlush(countFrames);
+
+        // Real time means producing one second of output per second, which
+        // at this speed takes s/100 seconds of input.
+        uint64_t outMs = benchOutFrames * 1000 / rate;
+        int32_t driftMs = (int32_t)((int64_t)(benchOutFrames * s / 100) - (int64_t)fed) * 1000 / (int32_t)rate;
+        uint32_t loadPermille = outMs ? (uint32_t)(busyUs / outMs) : 0;
+        uint32_t cyclesX100 = benchOutFrames ? (uint32_t)(cycles * 100 / benchOutFrames) : 0;
+        Serial.printf("[Stretch] %u.%02ux  out %5lu ms  drift %+ld ms  %3lu.%lu%% of a core  %lu.%02lu cycles/frame\n",
+                      s / 100, s % 100, (unsigned long)outMs, (long)driftMs, (unsigned long)(loadPermille / 10),
+                      (unsigned long)(loadPermille % 10), (unsigned long)(cyclesX100 / 100),
+                      (unsigned long)(cyclesX100 % 100));
+        Serial.printf("$TSR,%u,%llu,%llu,%llu,%lu,%lu\n", s, (unsigned long long)fed,
+                      (unsigned long long)benchOutFrames, (unsigned long long)busyUs, (unsigned long)loadPermille,
+                      (unsigned long)cyclesX100);
+    }
+
+    timeStretchReset();
+    speed = saved;
+}
@@ -0,0 +1,300 @@
+#include "track_probe.h"
+#include "file_manager.h"
+
+constexpr size_t MP3_SYNC_SEARCH = 4096;
+constexpr size_t MP3_HEADER_PEEK = 56;
+constexpr uint8_t FLAC_BLOCK_STREAMINFO = 0;
+constexpr uint8_t FLAC_BLOCK_SEEKTABLE = 3;
+constexpr size_t FLAC_STREAMINFO_LEN = 34;
+constexpr size_t FLAC_SEEKPOINT_LEN = 18;
+
+struct Mp3Header {
+    uint32_t sampleRate;
+    uint16_t bitrateKbps;
+    uint16_t frameLength;
+    uint16_t samplesPerFrame;
+    uint8_t channels;
+    bool mpeg1;
+};
+
+static uint32_t readLE32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t readBE32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint16_t readLE16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint64_t readBE64(const uint8_t *p) {
+    return ((uint64_t)readBE32(p) << 32) | readBE32(p + 4);
+}
+
+static size_t id3Size(File &f) {
+    uint8_t id3[10];
+    if (f.read(id3, sizeof(id3)) != sizeof(id3) || memcmp(id3, "ID3", 3) != 0) return 0;
+    size_t size = 10 + (((id3[6] & 0x7F) << 21) | ((id3[7] & 0x7F) << 14) | ((id3[8] & 0x7F) << 7) | (id3[9] & 0x7F));
+    if (id3[5] & 0x10) size += 10;
+    return size;
+}
+
+static bool probeWav(File &f, TrackFormat &fmt) {
+    uint8_t hdr[12];
+    if (f.read(hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    if (memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) return false;
+
+    bool haveFmt = false;
+    uint8_t chunk[8];
+    while (f.read(chunk, sizeof(chunk)) == sizeof(chunk)) {
+        uint32_t size = readLE32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t body[16];
+            if (size < sizeof(body) || f.read(body, sizeof(body)) != sizeof(body)) return false;
+            uint16_t tag = readLE16(body);
+            fmt.channels = readLE16(body + 2);
+            fmt.sampleRate = readLE32(body + 4);
+            fmt.bitsPerSample = readLE16(body + 14);
+            if ((tag != 1 && tag != 0xFFFE) || fmt.sampleRate == 0 || fmt.channels == 0 || fmt.channels > 2 ||
+                (fmt.bitsPerSample != 8 && fmt.bitsPerSample != 16)) {
+                return false;
+            }
+            fmt.codec = CODEC_WAV;
+            fmt.blockFrames = 0;
+            haveFmt = true;
+            size -= sizeof(body);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFmt || size == 0) return false;
+            // Streaming encoders leave the size at 0xFFFFFFFF; trust the file instead.
+            uint32_t avail = f.size() - f.position();
+            if (size > avail) size = avail;
+            uint32_t bytesPerSec = fmt.sampleRate * fmt.channels * (fmt.bitsPerSample / 8);
+            fmt.durationMs = (uint64_t)size * 1000 / bytesPerSec;
+            return true;
+        }
+        if (!f.seek(f.position() + size + (size & 1))) break;
+    }
+    return false;
+}
+
+// Only layer III: that's all the decoder handles.
+static bool parseMp3Header(const uint8_t *p, Mp3Header &h) {
+    static const uint32_t kRates[3] = {44100, 48000, 32000};
+    static const uint16_t kBitrates[2][15] = {
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},     // MPEG 2/2.5
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320}, // MPEG 1
+    };
+
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+    uint8_t version = (p[1] >> 3) & 0x03;
+    uint8_t layer = (p[1] >> 1) & 0x03;
+    uint8_t bitrate = p[2] >> 4;
+    uint8_t rateIdx = (p[2] >> 2) & 0x03;
+    if (version == 1 || layer != 1 || bitrate == 0 || bitrate == 0x0F || rateIdx == 3) return false;
+
+    h.mpeg1 = (version == 3);
+    h.sampleRate = kRates[rateIdx];
+    if (version == 2) h.sampleRate /= 2;      // MPEG 2
+    else if (version == 0) h.sampleRate /= 4; // MPEG 2.5
+    h.bitrateKbps = kBitrates[h.mpeg1][bitrate];
+    h.samplesPerFrame = h.mpeg1 ? 1152 : 576;
+    h.frameLength = (h.samplesPerFrame / 8) * h.bitrateKbps * 1000 / h.sampleRate + ((p[2] >> 1) & 0x01);
+    h.channels = ((p[3] >> 6) == 3) ? 1 : 2;
+    return true;
+}
+
+// A lone 0xFFE pattern turns up in album art and tag padding, so a sync only
+// counts if another frame with the same format starts right where it ends.
+static bool confirmMp3Frame(File &f, size_t pos, const Mp3Header &h, TrackFormat &fmt) {
+    uint8_t frame[MP3_HEADER_PEEK];
+    uint8_t next[4];
+    Mp3Header h2;
+    if (!f.seek(pos) || f.read(frame, sizeof(frame)) != sizeof(frame)) return false;
+    if (!f.seek(pos + h.frameLength) || f.read(next, sizeof(next)) != sizeof(next)) return false;
+    if (!parseMp3Header(next, h2) || h2.sampleRate != h.sampleRate || h2.mpeg1 != h.mpeg1) return false;
+
+    fmt.sampleRate = h.sampleRate;
+    fmt.bitsPerSample = 16;
+    fmt.channels = h.channels;
+    fmt.codec = CODEC_MP3;
+    fmt.blockFrames = h.samplesPerFrame;
+
+    // VBR files carry a frame count in a Xing/Info or VBRI header inside the
+    // first frame; otherwise assume CBR and estimate from the file size.
+    size_t side = h.mpeg1 ? (h.channels == 1 ? 17 : 32) : (h.channels == 1 ? 9 : 17);
+    const uint8_t *xing = frame + 4 + side;
+    uint32_t frames = 0;
+    if ((memcmp(xing, "Xing", 4) == 0 || memcmp(xing, "Info", 4) == 0) && (xing[7] & 0x01)) {
+        frames = readBE32(xing + 8);
+    } else if (memcmp(frame + 36, "VBRI", 4) == 0) {
+        frames = readBE32(frame + 36 + 14);
+    }
+    if (frames > 0) {
+        fmt.durationMs = (uint64_t)frames * h.samplesPerFrame * 1000 / h.sampleRate;
+    } else {
+        fmt.durationMs = (uint64_t)(f.size() - pos) * 8 / h.bitrateKbps;
+    }
+    return true;
+}
+
+static bool probeMp3(File &f, TrackFormat &fmt) {
+    size_t start = id3Size(f);
+
+    uint8_t buf[256];
+    size_t pos = start;
+    while (pos < start + MP3_SYNC_SEARCH) {
+        if (!f.seek(pos)) return false;
+        size_t got = f.read(buf, sizeof(buf));
+        if (got < 4) return false;
+        for (size_t i = 0; i + 3 < got; i++) {
+            Mp3Header h;
+            if (parseMp3Header(buf + i, h) && confirmMp3Frame(f, pos + i, h, fmt)) return true;
+        }
+        pos += got - 3;
+    }
+    return false;
+}
+
+// Leaves the file at the first metadata block header.
+static bool openFlac(File &f) {
+    uint8_t magic[4];
+    size_t start = id3Size(f);
+    return f.seek(start) && f.read(magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, "fLaC", 4) == 0;
+}
+
+static bool nextFlacBlock(File &f, uint8_t &type, uint32_t &len, bool &last) {
+    uint8_t hdr[4];
+    if (f.read(hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    last = hdr[0] & 0x80;
+    type = hdr[0] & 0x7F;
+    len = ((uint32_t)hdr[1] << 16) | (hdr[2] << 8) | hdr[3];
+    return type != 0x7F;
+}
+
+static bool probeFlac(File &f, TrackFormat &fmt) {
+    if (!openFlac(f)) return false;
+
+    // STREAMINFO is required to be the first block.
+    uint8_t type;
+    uint32_t len;
+    bool last;
+    uint8_t info[FLAC_STREAMINFO_LEN];
+    if (!nextFlacBlock(f, type, len, last) || type != FLAC_BLOCK_STREAMINFO || len < sizeof(info) ||
+        f.read(info, sizeof(info)) != sizeof(info)) {
+        return false;
+    }
+
+    fmt.codec = CODEC_FLAC;
+    fmt.blockFrames = (info[2] << 8) | info[3];
+    fmt.sampleRate = ((uint32_t)info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+    fmt.channels = ((info[12] >> 1) & 0x07) + 1;
+    fmt.bitsPerSample = (((info[12] & 0x01) << 4) | (info[13] >> 4)) + 1;
+    uint64_t totalSamples = ((uint64_t)(info[13] & 0x0F) << 32) | readBE32(info + 14);
+    if (fmt.sampleRate == 0 || fmt.channels > 2 || fmt.bitsPerSample < 8 || fmt.bitsPerSample > 24 ||
+        fmt.blockFrames < 16) {
+        return false;
+    }
+    fmt.durationMs = (uint64_t)totalSamples * 1000 / fmt.sampleRate;
+    return true;
+}
+
+bool probeTrackFile(File &f, const String &name, TrackFormat &fmt) {
+    String lower = name;
+    lower.toLowerCase();
+    fmt.durationMs = 0;
+    if (!f.seek(0)) return false;
+    if (lower.endsWith(".wav")) return probeWav(f, fmt);
+    if (lower.endsWith(".flac")) return probeFlac(f, fmt);
+    return probeMp3(f, fmt);
+}
+
+static bool findFlacSeek(File &f, uint32_t positionMs, uint32_t &fileOffset) {
+    if (!openFlac(f)) return false;
+
+    uint32_t sampleRate = 0;
+    uint64_t totalSamples = 0;
+    uint32_t tablePos = 0;
+    uint32_t tableLen = 0;
+    uint8_t type;
+    uint32_t len;
+    bool last = false;
+    while (!last && nextFlacBlock(f, type, len, last)) {
+        uint32_t body = f.position();
+        if (type == FLAC_BLOCK_STREAMINFO && len >= FLAC_STREAMINFO_LEN) {
+            uint8_t info[FLAC_STREAMINFO_LEN];
+            if (f.read(info, sizeof(info)) != sizeof(info)) return false;
+            sampleRate = ((uint32_t)info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+            totalSamples = ((uint64_t)(info[13] & 0x0F) << 32) | readBE32(info + 14);
+        } else if (type == FLAC_BLOCK_SEEKTABLE) {
+            tablePos = body;
+            tableLen = len;
+        }
+        if (!f.seek(body + len)) return false;
+    }
+    if (!last || sampleRate == 0 || tableLen < FLAC_SEEKPOINT_LEN) return false;
+
+    // Point offsets count from the first frame, which follows the metadata.
+    uint32_t audioStart = f.position();
+    uint64_t target = (uint64_t)positionMs * sampleRate / 1000;
+    uint64_t beforeSample = 0, beforeOffset = 0;
+    uint64_t afterSample = 0, afterOffset = 0;
+    bool haveAfter = false;
+    uint8_t point[FLAC_SEEKPOINT_LEN];
+    f.seek(tablePos);
+    for (uint32_t n = 0; n < tableLen / FLAC_SEEKPOINT_LEN; n++) {
+        if (f.read(point, sizeof(point)) != sizeof(point)) break;
+        uint64_t sample = readBE64(point);
+        if (sample == UINT64_MAX) continue; // placeholder
+        if (sample <= target) {
+            beforeSample = sample;
+            beforeOffset = readBE64(point + 8);
+        } else {
+            afterSample = sample;
+            afterOffset = readBE64(point + 8);
+            haveAfter = true;
+            break;
+        }
+    }
+
+    // Past the last point, the end of the file serves as one.
+    if (!haveAfter && totalSamples > beforeSample && f.size() > audioStart) {
+        afterSample = totalSamples;
+        afterOffset = f.size() - audioStart;
+        haveAfter = true;
+    }
+
+    uint64_t offset = beforeOffset;
+    if (haveAfter && afterOffset > beforeOffset) {
+        offset += (afterOffset - beforeOffset) * (target - beforeSample) / (afterSample - beforeSample);
+    }
+    fileOffset = audioStart + offset;
+    return true;
+}
+
+bool probeFlacSeek(const char *path, uint32_t positionMs, uint32_t &fileOffset) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File f = SD.open(path, FILE_READ);
+    bool ok = f && findFlacSeek(f, positionMs, fileOffset);
+    if (f) f.close();
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+bool probeTrackFormat(const char *path, TrackFormat &fmt) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File f = SD.open(path, FILE_READ);
+    bool ok = false;
+    if (f) {
+        ok = probeTrackFile(f, String(path), fmt);
+        f.close();
+    }
+    xSemaphoreGive(sdMutex);
+
+    if (ok) {
+        Serial.printf("[Probe] %s: %lu Hz, %u bit, %u ch, %lu ms\n", path, (unsigned long)fmt.sampleRate,
+                      fmt.bitsPerSample, fmt.channels, (unsigned long)fmt.durationMs);
+    }
+    return ok;
+}
@@ -2,16 +2,48 @@
 #include "font.h"
 #include "file_manager.h"
 #include "audio_config.h"
+#include "frame_scheduler.h"
+#include "profiler.h"
+#include "player_control.h"
+#include "input_manager.h"
+#include "sensor_service.h"
+#include "power_governor.h"
+#include "audio_output.h"
+#include "playback_state.h"
+#include "album_art.h"
+#include "lyrics.h"
+#include "remote_control.h"
+#include "signal_gen.h"
+#include "time_stretch.h"
+#include "waveform.h"
 
 UIState currentUIState = UI_FOLDER_SELECT;
 M5Canvas sprite1(&M5Cardputer.Display);
 M5Canvas sprite2(&M5Cardputer.Display);
 M5Canvas overlaySprite(&M5Cardputer.Display);
+static M5Canvas artSprite(&M5Cardputer.Display);
+static uint32_t artRequest = 0;
+// Whether the audio task holds a track that CMD_RESUME can continue.
+static bool trackLoaded = false;
+static uint32_t artGeneration = UINT32_MAX;
+static int32_t shownLyric = -1;
+static unsigned long positionStampMs = 0;
+static uint32_t trackDurationMs = 0;
+static uint32_t failedInARow = 0;
+static int8_t diagSignal = -1;
+static uint16_t playbackSpeed = 100;
+static int16_t seekMarker = -1;
+static uint32_t waveRequest = 0;
 
-bool nextTrackRequest = false;
 const uint8_t VISIBLE_FILE_COUNT = 10;
+constexpr int32_t SLIDER_TOP = 8;
+constexpr int32_t SLIDER_HEIGHT = 122;
+constexpr int32_t SLIDER_MIN_THUMB = 6;
 constexpr unsigned long HOLD_DELAY = 1500;
 constexpr int SCROLL_SPEED = 1;
+constexpr int32_t WAVE_X = 148;
+constexpr int32_t WAVE_MID_Y = 50;
+constexpr int32_t WAVE_HALF_HEIGHT = 5;
 
 bool isScreenDimmed = false;
 constexpr unsigned long SCREEN_DIM_TIMEOUT = 30000;
@@ -19,28 +51,38 @@ constexpr uint8_t DIMMED_BRIGHTNESS = 0;
 unsigned long lastActivityTime = 0;
 uint8_t savedBrightness = 128;
 
+constexpr uint32_t PLAYER_FRAME_MS = 160;
+constexpr uint32_t HUD_FRAME_MS = 1000;
+constexpr uint32_t INPUT_POLL_ACTIVE_MS = 10;
+constexpr uint32_t INPUT_POLL_IDLE_MS = 40;
+constexpr uint32_t INPUT_POLL_DIMMED_MS = 100;
+constexpr unsigned long INPUT_ACTIVE_WINDOW_MS = 2000;
+
 
 uint8_t sliderPos = 0;
 int16_t textPos = 90;
-uint8_t graphSpeed = 0;
-uint8_t g[14] = {0};
 unsigned short grays[18];
 unsigned short gray;
 unsigned short light;
-unsigned long trackStartMillis = 0;
-unsigned long playbackTime = 0; 
+unsigned long playbackTime = 0;
 
 static uint8_t volumeStep = 4;
 static uint8_t brightnessStep = 32;
 static uint8_t selectedFolderIndex = 0;
-static uint8_t selectedFileIndex = 0;
-static uint16_t viewStartIndex = 0;
+static uint32_t selectedFileIndex = 0;
+static uint32_t viewStartIndex = 0;
+
+static void onSensorChange(SensorId id, int32_t) {
+    if (id == SENSOR_BATTERY) requestRedraw(REDRAW_STATE);
+}
 
 void initUI() {
     M5Cardputer.Display.setRotation(1);
     M5Cardputer.Display.setBrightness(savedBrightness);
     sprite1.createSprite(240, 135);
     sprite2.createSprite(86, 16);
+    overlaySprite.createSprite(126, 79);
+    artSprite.createSprite(ALBUM_ART_SIZE, ALBUM_ART_SIZE);
 
     uint8_t co = 214;
     for (uint8_t i = 0; i < 18; i++) {
@@ -49,6 +91,7 @@ void initUI() {
     }
     
     lastActivityTime = millis();
+    sensorSubscribe(onSensorChange);
 }
 
 
@@ -74,9 +117,17 @@ void checkScreenTimeout() {
 }
 
 
+// Position events arrive every 250 ms; interpolate between them so lyric
+// changes land on time. Positions are in track time, which runs at the
+// playback speed.
+static uint32_t currentPositionMs() {
+    if (!isPlaying || isStoped) return playbackTime;
+    unsigned long since = millis() - positionStampMs;
+    return playbackTime + min(since, 500UL) * playbackSpeed / 100;
+}
+
 String getPlaybackTimeString() {
     unsigned long elapsed = playbackTime;
-    if (isPlaying && !isStoped) elapsed = millis() - trackStartMillis;
     
     unsigned int seconds = (elapsed / 1000) % 60;
     unsigned int minutes = (elapsed / 1000) / 60;
@@ -134,7 +185,7 @@ void drawFolderSelect() {
     sprite1.setTextFont(0);
     sprite1.setTextColor(GREEN, gray);
     sprite1.setTextDatum(2);
-    sprite1.drawString("[Audios: " + String(fileCount) + "]", 230, 12);
+    sprite1.drawString("[Audios: " + String(browseAudioCount) + "]", 230, 12);
 
     sprite1.setTextFont(0);
     sprite1.setTextDatum(0);
@@ -193,200 +244,545 @@ void drawFolderSelect() {
         sprite1.drawString(displayName, 14, y + 1);
         y += lineHeight;
     }
+}
 
-    sprite1.pushSprite(0, 0);
+static int32_t playedBin() {
+    if (trackDurationMs == 0) return 0;
+    return min((uint64_t)currentPositionMs() * WAVEFORM_BINS / trackDurationMs, (uint64_t)WAVEFORM_BINS - 1);
 }
 
-void drawPlayer() {
-    if (graphSpeed == 0) {
-        gray = grays[15];
-        light = grays[11];
-        sprite1.fillRect(0, 0, 240, 135, gray);
-        sprite1.fillRect(4, 8, 130, 122, BLACK);
-        sprite1.fillRect(129, 8, 5, 122, 0x0841);
-
-        if (fileCount > 0) {
-            sliderPos = map(selectedFileIndex, 0, max(1, fileCount - 1), 8, 110);
-        } else {
-            sliderPos = 8;
-        }
-        sprite1.fillRect(129, sliderPos, 5, 20, grays[2]);
-        sprite1.fillRect(131, sliderPos + 4, 1, 12, grays[16]);
-
-        sprite1.fillRect(4, 2, 50, 2, ORANGE);
-        sprite1.fillRect(84, 2, 50, 2, ORANGE);
-        sprite1.fillRect(190, 2, 45, 2, ORANGE);
-        sprite1.fillRect(190, 6, 45, 3, grays[4]);
-        
-        sprite1.drawFastVLine(3, 9, 120, light);
-        sprite1.drawFastVLine(134, 9, 120, light);
-        sprite1.drawFastHLine(3, 129, 130, light);
-        sprite1.drawFastHLine(0, 0, 240, light);
-        sprite1.drawFastHLine(0, 134, 240, light);
-        
-        sprite1.fillRect(139, 0, 3, 135, BLACK);
-        sprite1.fillRect(148, 14, 86, 42, BLACK);
-        sprite1.fillRect(148, 59, 86, 16, BLACK);
-
-        sprite1.fillTriangle(162, 18, 162, 26, 168, 22, GREEN);
-        sprite1.fillRect(162, 30, 6, 6, RED);
-        
-        sprite1.drawFastVLine(143, 0, 135, light);
-        sprite1.drawFastVLine(238, 0, 135, light);
-        sprite1.drawFastVLine(138, 0, 135, light);
-        sprite1.drawFastVLine(148, 14, 42, light);
-        sprite1.drawFastHLine(148, 14, 86, light);
-
-        for (int i = 0; i < 4; i++)
-            sprite1.fillRoundRect(148 + (i * 22), 94, 18, 18, 3, grays[4]);
-
-        sprite1.fillRect(220, 104, 8, 2, grays[13]);
-        sprite1.fillRect(220, 108, 8, 2, grays[13]);
-        sprite1.fillTriangle(228, 102, 228, 106, 231, 105, grays[13]);
-        sprite1.fillTriangle(220, 106, 220, 110, 217, 109, grays[13]);
-        
-        if (!isStoped) {
-            sprite1.fillRect(152, 104, 3, 6, grays[13]);
-            sprite1.fillRect(157, 104, 3, 6, grays[13]);
-        } else {
-            sprite1.fillTriangle(156, 102, 156, 110, 160, 106, grays[13]);
+// Peak envelope along the bottom of the info panel, played part lit, with
+// the playhead and the seek marker on top. Next to album art it is folded
+// to half width. Only ever draws from the cached envelope.
+static void drawWaveform(bool compact) {
+    if (fileCount == 0 || isStoped || trackDurationMs == 0) return;
+
+    const int32_t fold = compact ? 2 : 1;
+    const int32_t columns = WAVEFORM_BINS / fold;
+    const int32_t played = playedBin() / fold;
+    static int8_t peaks[WAVEFORM_BINS * 2];
+    if (waveformFor(waveRequest, peaks)) {
+        for (int32_t c = 0; c < columns; c++) {
+            int32_t lo = 0, hi = 0;
+            for (int32_t k = 0; k < fold; k++) {
+                lo = min(lo, (int32_t)peaks[2 * (c * fold + k)]);
+                hi = max(hi, (int32_t)peaks[2 * (c * fold + k) + 1]);
+            }
+            int32_t top = WAVE_MID_Y - hi * WAVE_HALF_HEIGHT / 127;
+            int32_t bottom = WAVE_MID_Y - lo * WAVE_HALF_HEIGHT / 127;
+            sprite1.drawFastVLine(WAVE_X + c, top, bottom - top + 1, c <= played ? GREEN : grays[6]);
         }
+    } else {
+        sprite1.drawFastHLine(WAVE_X, WAVE_MID_Y, columns, grays[6]);
+        sprite1.drawFastHLine(WAVE_X, WAVE_MID_Y, played + 1, GREEN);
+    }
+    sprite1.drawFastVLine(WAVE_X + played, WAVE_MID_Y - WAVE_HALF_HEIGHT, 2 * WAVE_HALF_HEIGHT + 1, WHITE);
+    if (seekMarker >= 0) {
+        sprite1.drawFastVLine(WAVE_X + seekMarker / fold, WAVE_MID_Y - WAVE_HALF_HEIGHT, 2 * WAVE_HALF_HEIGHT + 1, YELLOW);
+    }
+}
 
-        const int32_t volBarX = 172;
-        const int32_t volBarY = 82;
-        const int32_t volBarWidth = 60;
-        const int32_t volSliderWidth = 10;
-        
-        sprite1.fillRoundRect(volBarX, volBarY, volBarWidth, 3, 2, YELLOW);
-
-        int volSliderX = volBarX + map(volume, 0, 64, 0, volBarWidth - volSliderWidth);
-        sprite1.fillRoundRect(volSliderX, volBarY - 2, volSliderWidth, 8, 2, grays[2]);
-        sprite1.fillRoundRect(volSliderX + 2, volBarY, 6, 4, 2, grays[10]);
-
-        const int32_t brigBarX = 172;
-        const int32_t brigBarY = 124;
-        const int32_t brigBarWidth = 30;
-        const int32_t brigSliderWidth = 10;
-        
-        sprite1.fillRoundRect(brigBarX, brigBarY, brigBarWidth, 3, 2, MAGENTA);
-
-        int32_t brigSliderX = brigBarX + map(M5Cardputer.Display.getBrightness(), 0, 255, 0, brigBarWidth - brigSliderWidth);
-        sprite1.fillRoundRect(brigSliderX, brigBarY - 2, brigSliderWidth, 8, 2, grays[2]);
-        sprite1.fillRoundRect(brigSliderX + 2, brigBarY, 6, 4, 2, grays[10]);
-
-        sprite1.drawRect(206, 119, 28, 12, GREEN);
-        sprite1.fillRect(234, 122, 3, 6, GREEN);
-
-        for (int i = 0; i < 14; i++) {
-            if (!isStoped)
-                g[i] = random(1, 5);
-            for (int j = 0; j < g[i]; j++)
-                sprite1.fillRect(172 + (i * 4), 50 - j * 3, 3, 2, grays[4]);
-        }
+void drawPlayer() {
+    gray = grays[15];
+    light = grays[11];
+    sprite1.fillRect(0, 0, 240, 135, gray);
+    sprite1.fillRect(4, 8, 130, 122, BLACK);
+    sprite1.fillRect(129, 8, 5, 122, 0x0841);
+
+    int32_t thumbHeight = SLIDER_HEIGHT;
+    sliderPos = SLIDER_TOP;
+    if (fileCount > VISIBLE_FILE_COUNT) {
+        thumbHeight = max(SLIDER_MIN_THUMB, (int32_t)((uint64_t)SLIDER_HEIGHT * VISIBLE_FILE_COUNT / fileCount));
+        sliderPos = SLIDER_TOP + (uint64_t)(SLIDER_HEIGHT - thumbHeight) * viewStartIndex / (fileCount - VISIBLE_FILE_COUNT);
+    }
+    sprite1.fillRect(129, sliderPos, 5, thumbHeight, grays[2]);
+    if (thumbHeight > 8) sprite1.fillRect(131, sliderPos + 4, 1, thumbHeight - 8, grays[16]);
 
-        sprite1.setTextFont(0);
-        sprite1.setTextDatum(0);
-        
-        if (fileCount == 0) {
-            sprite1.setTextColor(RED, BLACK);
-            sprite1.drawString("No files found!", 8, 50);
-        } else {
-            if (fileCount <= VISIBLE_FILE_COUNT) {
-                viewStartIndex = 0;
-            } else if (viewStartIndex > fileCount - VISIBLE_FILE_COUNT) {
-                viewStartIndex = fileCount - VISIBLE_FILE_COUNT;
+    sprite1.fillRect(4, 2, 50, 2, ORANGE);
+    sprite1.fillRect(84, 2, 50, 2, ORANGE);
+    sprite1.fillRect(190, 2, 45, 2, ORANGE);
+    sprite1.fillRect(190, 6, 45, 3, grays[4]);
+    
+    sprite1.drawFastVLine(3, 9, 120, light);
+    sprite1.drawFastVLine(134, 9, 120, light);
+    sprite1.drawFastHLine(3, 129, 130, light);
+    sprite1.drawFastHLine(0, 0, 240, light);
+    sprite1.drawFastHLine(0, 134, 240, light);
+    
+    sprite1.fillRect(139, 0, 3, 135, BLACK);
+    sprite1.fillRect(148, 14, 86, 42, BLACK);
+    sprite1.fillRect(148, 59, 86, 16, BLACK);
+
+    sprite1.fillTriangle(162, 18, 162, 26, 168, 22, GREEN);
+    sprite1.fillRect(162, 30, 6, 6, RED);
+    
+    sprite1.drawFastVLine(143, 0, 135, light);
+    sprite1.drawFastVLine(238, 0, 135, light);
+    sprite1.drawFastVLine(138, 0, 135, light);
+    sprite1.drawFastVLine(148, 14, 42, light);
+    sprite1.drawFastHLine(148, 14, 86, light);
+
+    for (int i = 0; i < 4; i++)
+        sprite1.fillRoundRect(148 + (i * 22), 94, 18, 18, 3, grays[4]);
+
+    sprite1.fillRect(220, 104, 8, 2, grays[13]);
+    sprite1.fillRect(220, 108, 8, 2, grays[13]);
+    sprite1.fillTriangle(228, 102, 228, 106, 231, 105, grays[13]);
+    sprite1.fillTriangle(220, 106, 220, 110, 217, 109, grays[13]);
+    
+    if (!isStoped) {
+        sprite1.fillRect(152, 104, 3, 6, grays[13]);
+        sprite1.fillRect(157, 104, 3, 6, grays[13]);
+    } else {
+        sprite1.fillTriangle(156, 102, 156, 110, 160, 106, grays[13]);
+    }
+
+    const int32_t volBarX = 172;
+    const int32_t volBarY = 82;
+    const int32_t volBarWidth = 60;
+    const int32_t volSliderWidth = 10;
+    
+    sprite1.fillRoundRect(volBarX, volBarY, volBarWidth, 3, 2, YELLOW);
+
+    int volSliderX = volBarX + map(volume, 0, 64, 0, volBarWidth - volSliderWidth);
+    sprite1.fillRoundRect(volSliderX, volBarY - 2, volSliderWidth, 8, 2, grays[2]);
+    sprite1.fillRoundRect(volSliderX + 2, volBarY, 6, 4, 2, grays[10]);
+
+    const int32_t brigBarX = 172;
+    const int32_t brigBarY = 124;
+    const int32_t brigBarWidth = 30;
+    const int32_t brigSliderWidth = 10;
+    
+    sprite1.fillRoundRect(brigBarX, brigBarY, brigBarWidth, 3, 2, MAGENTA);
+
+    int32_t brigSliderX = brigBarX + map(M5Cardputer.Display.getBrightness(), 0, 255, 0, brigBarWidth - brigSliderWidth);
+    sprite1.fillRoundRect(brigSliderX, brigBarY - 2, brigSliderWidth, 8, 2, grays[2]);
+    sprite1.fillRoundRect(brigSliderX + 2, brigBarY, 6, 4, 2, grays[10]);
+
+    sprite1.drawRect(206, 119, 28, 12, GREEN);
+    sprite1.fillRect(234, 122, 3, 6, GREEN);
+
+    bool showArt = fileCount > 0 && albumArtFor(artRequest, (uint16_t *)artSprite.getBuffer(), artGeneration);
+    if (showArt) artSprite.pushSprite(&sprite1, 234 - ALBUM_ART_SIZE, 14);
+    drawWaveform(showArt);
+
+    sprite1.setTextFont(0);
+    sprite1.setTextDatum(0);
+    
+    if (fileCount == 0) {
+        sprite1.setTextColor(RED, BLACK);
+        sprite1.drawString("No files found!", 8, 50);
+    } else {
+        if (fileCount <= VISIBLE_FILE_COUNT) {
+            viewStartIndex = 0;
+        } else if (viewStartIndex > fileCount - VISIBLE_FILE_COUNT) {
+            viewStartIndex = fileCount - VISIBLE_FILE_COUNT;
+        }
+        uint32_t startIdx = viewStartIndex;
+        prefetchTracks(startIdx, VISIBLE_FILE_COUNT);
+        for (uint32_t i = 0; i < VISIBLE_FILE_COUNT && (startIdx + i) < fileCount; i++) {
+            uint32_t idx = startIdx + i;
+            bool isNow = (idx == currentFileIndex);
+            bool isCursor = (idx == selectedFileIndex);
+
+            if (isNow) {
+                sprite1.setTextColor(WHITE, BLACK);
+            } else if (isCursor) {
+                sprite1.setTextColor(YELLOW, BLACK);
+            } else {
+                sprite1.setTextColor(GREEN, BLACK);
             }
-            int startIdx = viewStartIndex;
-            for (int i = 0; i < 10 && (startIdx + i) < fileCount; i++) {
-                int idx = startIdx + i;
-                bool isNow = (idx == currentFileIndex);
-                bool isCursor = (idx == selectedFileIndex);
-
-                if (isNow) {
-                    sprite1.setTextColor(WHITE, BLACK);
-                } else if (isCursor) {
-                    sprite1.setTextColor(YELLOW, BLACK);
-                } else {
-                    sprite1.setTextColor(GREEN, BLACK);
-                }
 
-                if (isCursor) {
-                    sprite1.drawString(">", 2, 10 + (i * 12));
-                    sprite1.drawString(getFileName(idx).substring(0, 20), 12, 10 + (i * 12));
-                } else {
-                    sprite1.drawString(getFileName(idx).substring(0, 20), 8, 10 + (i * 12));
-                }
+            if (isCursor) {
+                sprite1.drawString(">", 2, 10 + (i * 12));
+                sprite1.drawString(getFileName(idx).substring(0, 20), 12, 10 + (i * 12));
+            } else {
+                sprite1.drawString(getFileName(idx).substring(0, 20), 8, 10 + (i * 12));
             }
         }
+    }
 
-        sprite1.setTextColor(grays[1], gray);
-        sprite1.drawString("MP3 Adv", 150, 4);
-        sprite1.setTextColor(grays[2], gray);
-        sprite1.drawString("LIST", 58, 0);
-        sprite1.setTextColor(grays[4], gray);
-        sprite1.drawString("VOL", 150, 80);
-        sprite1.setTextColor(grays[4], gray);
-        sprite1.drawString("LIG", 150, 122);
-
-        if (isPlaying) {
-            sprite1.setTextColor(grays[8], BLACK);
-            sprite1.drawString("P", 152, 18);
-            sprite1.drawString("L", 152, 27);
-            sprite1.drawString("A", 152, 36);
-            sprite1.drawString("Y", 152, 45);
-        } else {
-            sprite1.setTextColor(grays[8], BLACK);
-            sprite1.drawString("S", 152, 18);
-            sprite1.drawString("T", 152, 27);
-            sprite1.drawString("O", 152, 36);
-            sprite1.drawString("P", 152, 45);
-        }
+    sprite1.setTextColor(grays[1], gray);
+    sprite1.drawString("MP3 Adv", 150, 4);
+    if (playbackSpeed != 100) {
+        char speedBuf[8];
+        snprintf(speedBuf, sizeof(speedBuf), "%u.%02ux", playbackSpeed / 100, playbackSpeed % 100);
+        sprite1.drawString(speedBuf, 204, 4);
+    }
+    sprite1.setTextColor(grays[2], gray);
+    sprite1.drawString("LIST", 58, 0);
+    sprite1.setTextColor(grays[4], gray);
+    sprite1.drawString("VOL", 150, 80);
+    sprite1.setTextColor(grays[4], gray);
+    sprite1.drawString("LIG", 150, 122);
+
+    if (isPlaying) {
+        sprite1.setTextColor(grays[8], BLACK);
+        sprite1.drawString("P", 152, 18);
+        sprite1.drawString("L", 152, 27);
+        sprite1.drawString("A", 152, 36);
+        sprite1.drawString("Y", 152, 45);
+    } else {
+        sprite1.setTextColor(grays[8], BLACK);
+        sprite1.drawString("S", 152, 18);
+        sprite1.drawString("T", 152, 27);
+        sprite1.drawString("O", 152, 36);
+        sprite1.drawString("P", 152, 45);
+    }
 
-        sprite1.setTextColor(GREEN, BLACK);
+    sprite1.setTextColor(GREEN, BLACK);
+    if (showArt) {
+        if (!isStoped)
+            sprite1.drawString(getPlaybackTimeString(), 160, 36);
+    } else {
         sprite1.setFont(&DSEG7_Classic_Mini_Regular_16);
         if (!isStoped)
             sprite1.drawString(getPlaybackTimeString(), 172, 18);
         sprite1.setTextFont(0);
+    }
 
-        sprite1.setTextDatum(3);
-        sprite1.drawString(String(M5Cardputer.Power.getBatteryLevel()) + "%", 220, 121);
-
-        sprite1.setTextColor(BLACK, grays[4]);
-        sprite1.drawString("R", 220, 96);
-        sprite1.drawString("N", 198, 96);
-        sprite1.drawString("P", 176, 96);
-        sprite1.drawString("A", 154, 96);
-        sprite1.setTextColor(BLACK, grays[5]);
-        sprite1.drawString(">>", 202, 103);
-        sprite1.drawString("<<", 180, 103);
-
-        sprite2.fillSprite(BLACK);
-        sprite2.setTextColor(GREEN, BLACK);
-        if (!isStoped && fileCount > 0) {
+    sprite1.setTextDatum(3);
+    sprite1.drawString(String(batteryLevel()) + "%", 220, 121);
+
+    sprite1.setTextColor(BLACK, grays[4]);
+    sprite1.drawString("R", 220, 96);
+    sprite1.drawString("N", 198, 96);
+    sprite1.drawString("P", 176, 96);
+    sprite1.drawString("A", 154, 96);
+    sprite1.setTextColor(BLACK, grays[5]);
+    sprite1.drawString(">>", 202, 103);
+    sprite1.drawString("<<", 180, 103);
+
+    sprite2.fillSprite(BLACK);
+    sprite2.setTextColor(GREEN, BLACK);
+    int32_t lyric = lyricsLoaded() ? lyricLineAt(currentPositionMs()) : -1;
+    if (lyric >= 0) {
+        if (lyric != shownLyric) {
+            shownLyric = lyric;
+            textPos = 0;
+        }
+        const String &text = lyricText(lyric);
+        int32_t width = sprite2.textWidth(text);
+        sprite2.setTextColor(CYAN, BLACK);
+        sprite2.drawString(text, textPos, 4);
+        if (width > 86) {
+            textPos -= 2;
+            if (textPos < -width) textPos = 86;
+        }
+    } else {
+        if (shownLyric >= 0) {
+            shownLyric = -1;
+            textPos = 90;
+        }
+        if (diagSignal >= 0) {
+            sprite2.drawString(String("DIAG ") + signalName((SignalType)diagSignal), textPos, 4);
+        } else if (!isStoped && fileCount > 0) {
             sprite2.drawString(getFileName(currentFileIndex), textPos, 4);
         }
         textPos -= 2;
         if (textPos < -300) textPos = 90;
-        
-        sprite2.pushSprite(&sprite1, 148, 59);
-        sprite1.pushSprite(0, 0);
     }
     
-    graphSpeed++;
-    if (graphSpeed == 4) graphSpeed = 0;
+    sprite2.pushSprite(&sprite1, 148, 59);
+}
+
+void drawProfilerOverlay() {
+    const ProfilerSnapshot &ps = getProfilerSnapshot();
+    char line[48];
+
+    overlaySprite.fillSprite(BLACK);
+    overlaySprite.drawRect(0, 0, 126, 79, ORANGE);
+    overlaySprite.setTextFont(0);
+    overlaySprite.setTextDatum(0);
+    overlaySprite.setTextColor(ORANGE, BLACK);
+
+    snprintf(line, sizeof(line), "FPS %u.%u R%lu P%lu", ps.fpsX10 / 10, ps.fpsX10 % 10,
+             (unsigned long)ps.renderUs, (unsigned long)ps.pushUs);
+    overlaySprite.drawString(line, 3, 3);
+    snprintf(line, sizeof(line), "CPU UI%u%% AU%u%%", ps.cpuPct[PROF_TASK_UI], ps.cpuPct[PROF_TASK_AUDIO]);
+    overlaySprite.drawString(line, 3, 12);
+    snprintf(line, sizeof(line), "STK UI%lu AU%lu", (unsigned long)ps.stackFree[PROF_TASK_UI],
+             (unsigned long)ps.stackFree[PROF_TASK_AUDIO]);
+    overlaySprite.drawString(line, 3, 21);
+    snprintf(line, sizeof(line), "AUD %lu/%luus U%lu", (unsigned long)ps.audioPeriodAvgUs,
+             (unsigned long)ps.audioPeriodMaxUs, (unsigned long)ps.underruns);
+    overlaySprite.drawString(line, 3, 30);
+    snprintf(line, sizeof(line), "HEAP %luk/%luk", (unsigned long)(ps.heapFree / 1024),
+             (unsigned long)(ps.heapLargest / 1024));
+    overlaySprite.drawString(line, 3, 39);
+    snprintf(line, sizeof(line), "LAT A%lu P%lu S%lu K%lums",
+             (unsigned long)(ps.latency[PROF_LAT_KEY_TO_AUDIO].lastUs / 1000),
+             (unsigned long)(ps.latency[PROF_LAT_KEY_TO_PIXELS].lastUs / 1000),
+             (unsigned long)(ps.latency[PROF_LAT_KEY_TO_SILENCE].lastUs / 1000),
+             (unsigned long)(ps.latency[PROF_LAT_SKIP_TO_AUDIO].lastUs / 1000));
+    overlaySprite.drawString(line, 3, 48);
+    PowerStats pw = getPowerStats();
+    snprintf(line, sizeof(line), "PWR %uMHz W%u/%u", pw.cpuMhz,
+             ps.wakeups[PROF_TASK_UI], ps.wakeups[PROF_TASK_AUDIO]);
+    overlaySprite.drawString(line, 3, 57);
+    AudioOutputStats ao = getAudioOutputStats();
+    snprintf(line, sizeof(line), "DMA %ux%u U%lu %lums", ao.dmaCount, ao.dmaLen,
+             (unsigned long)ao.underruns, (unsigned long)(ao.latencyUs / 1000));
+    overlaySprite.drawString(line, 3, 66);
+
+    overlaySprite.pushSprite(&sprite1, 6, 10);
+}
+
+uint32_t getFrameIntervalMs() {
+    if (isScreenDimmed) return 0;
+
+    uint32_t interval = 0;
+    if (currentUIState == UI_PLAYER && !isStoped) interval = PLAYER_FRAME_MS;
+    if (profilerHudVisible && (interval == 0 || interval > HUD_FRAME_MS)) interval = HUD_FRAME_MS;
+    return interval;
 }
 
-void draw() {
+uint32_t getInputPollMs() {
+    if (inputInterruptActive()) return INPUT_FALLBACK_POLL_MS;
+    if (isScreenDimmed) return INPUT_POLL_DIMMED_MS;
+    if (millis() - lastActivityTime < INPUT_ACTIVE_WINDOW_MS) return INPUT_POLL_ACTIVE_MS;
+    return INPUT_POLL_IDLE_MS;
+}
+
+bool draw() {
     checkScreenTimeout();
-    
+    if (isScreenDimmed) {
+        cancelScheduledRedraw();
+        return false;
+    }
+
+    beginFrame();
     if (currentUIState == UI_FOLDER_SELECT) {
         drawFolderSelect();
     } else {
         drawPlayer();
     }
+    if (profilerHudVisible) drawProfilerOverlay();
+    endFrame();
+
+    unsigned long pushStart = micros();
+    sprite1.pushSprite(0, 0);
+    profilerFramePushed(micros() - pushStart);
+
+    uint32_t interval = getFrameIntervalMs();
+    if (interval > 0) scheduleRedrawIn(interval);
+    return true;
+}
+
+static void playTrack(uint32_t index, uint32_t startMs = 0) {
+    if (fileCount == 0) return;
+    diagSignal = -1;
+    currentFileIndex = index;
+    playbackTime = startMs;
+    isPlaying = true;
+    isStoped = false;
+    trackLoaded = true;
+    textPos = 90;
+    positionStampMs = millis();
+    TrackFormat fmt;
+    trackDurationMs = getTrackFormat(index, fmt) ? fmt.durationMs : 0;
+    seekMarker = -1;
+    String path = getTrackPath(index);
+    powerGovernorBoost();
+    sendPlayTrack(index, path, startMs);
+    artRequest = requestAlbumArt(path);
+    waveRequest = requestWaveform(path);
+    loadLyrics(path);
+    shownLyric = -1;
+}
+
+// Navigation lands on playable entries only; with none left, stop.
+static void playPlayable(int32_t index) {
+    if (index < 0) {
+        sendPlayerCommand(CMD_STOP);
+        isPlaying = false;
+        isStoped = true;
+        trackLoaded = false;
+        return;
+    }
+    playTrack(index);
+}
+
+static void centerListOn(uint32_t index) {
+    selectedFileIndex = index;
+    if (fileCount <= VISIBLE_FILE_COUNT) {
+        viewStartIndex = 0;
+    } else {
+        viewStartIndex = (index > VISIBLE_FILE_COUNT / 2) ? index - VISIBLE_FILE_COUNT / 2 : 0;
+        if (viewStartIndex > fileCount - VISIBLE_FILE_COUNT) viewStartIndex = fileCount - VISIBLE_FILE_COUNT;
+    }
+}
+
+static void savePlaybackState(bool force) {
+    String path = getTrackPath(currentFileIndex);
+    PlaybackState state;
+    state.folder = getPlaylistFolder();
+    state.track = path.substring(path.lastIndexOf('/') + 1);
+    state.index = currentFileIndex;
+    state.positionMs = playbackTime;
+    state.folderMtime = getPlaylistMtime();
+    updatePlaybackState(state, force);
 }
 
-void handleKeyPress(char key) {
+bool resumeLastSession() {
+    PlaybackState state;
+    uint32_t mtime;
+    if (!loadPlaybackState(state) || !getFolderMtime(state.folder, mtime)) return false;
+
+    // An unchanged folder keeps its on-card index, so only a changed one is rescanned.
+    if (mtime != state.folderMtime) {
+        openDirectory(state.folder);
+    } else {
+        currentFolder = state.folder;
+    }
+    if (!loadPlaylist(state.folder) || fileCount == 0) return false;
+
+    uint32_t index = state.index;
+    uint32_t positionMs = state.positionMs;
+    String path = getTrackPath(index);
+    if (index >= fileCount || path.substring(path.lastIndexOf('/') + 1) != state.track) {
+        int32_t found = findTrack(state.track);
+        index = (found >= 0) ? found : 0;
+        if (found < 0) positionMs = 0;
+    }
+
+    Serial.printf("Resuming %s track %lu at %lu ms\n", state.folder.c_str(), (unsigned long)index, (unsigned long)positionMs);
+    currentUIState = UI_PLAYER;
+    centerListOn(index);
+    playTrack(index, positionMs);
+    return true;
+}
+
+void getPlayerSnapshot(PlayerSnapshot &snap) {
+    snap.uiState = currentUIState;
+    snap.playing = isPlaying;
+    snap.stopped = isStoped;
+    snap.screenDimmed = isScreenDimmed;
+    snap.fileCount = fileCount;
+    snap.trackIndex = currentFileIndex;
+    snap.positionMs = currentPositionMs();
+    snap.durationMs = trackDurationMs;
+    snap.volume = volume;
+    snap.brightness = savedBrightness;
+    snap.folder = currentUIState == UI_PLAYER ? getPlaylistFolder() : currentFolder;
+    snap.track = fileCount > 0 ? getFileName(currentFileIndex) : String();
+}
+
+// Remote actions go through the same paths as the keys that do the same
+// thing, so scripted runs exercise what a user would.
+bool handleRemoteAction(uint8_t action, int32_t value, const String &path) {
+    switch (action) {
+    case REMOTE_ACT_PLAY:
+        if (currentUIState != UI_PLAYER || value < 0 || (uint32_t)value >= fileCount) return false;
+        resetActivityTimer();
+        centerListOn(value);
+        playTrack(value);
+        return true;
+    case REMOTE_ACT_NEXT:
+    case REMOTE_ACT_PREV:
+    case REMOTE_ACT_TOGGLE_PAUSE:
+    case REMOTE_ACT_STOP:
+        if (currentUIState != UI_PLAYER) return false;
+        handleKeyPress(action == REMOTE_ACT_NEXT ? 'n' : action == REMOTE_ACT_PREV ? 'p' :
+                       action == REMOTE_ACT_TOGGLE_PAUSE ? ' ' : '`');
+        return true;
+    case REMOTE_ACT_SEEK:
+        if (currentUIState != UI_PLAYER || isStoped || value < 0) return false;
+        resetActivityTimer();
+        sendPlayerCommand(CMD_SEEK, value);
+        playbackTime = value;
+        positionStampMs = millis();
+        return true;
+    case REMOTE_ACT_VOLUME:
+        if (value < 0 || value > 64) return false;
+        changeVolume(value - volume);
+        return true;
+    case REMOTE_ACT_OPEN_FOLDER: {
+        // Validate against the folder's own index first: a bad index must not
+        // swap the playlist out from under the playing track.
+        uint32_t count;
+        if (value < 0 || !getFolderTrackCount(path, count) || (uint32_t)value >= count) return false;
+        if (!loadPlaylist(path) || (uint32_t)value >= fileCount) return false;
+        resetActivityTimer();
+        currentFolder = path;
+        currentUIState = UI_PLAYER;
+        centerListOn(value);
+        playTrack(value);
+        return true;
+    }
+    case REMOTE_ACT_SCAN:
+        openDirectory(path);
+        return true;
+    }
+    return false;
+}
+
+bool processPlayerEvents() {
+    PlayerEvent evt;
+    bool changed = false;
+
+    while (playerEvents.pop(evt)) {
+        if (evt.trackIndex != currentFileIndex || evt.generation != currentPlayGeneration()) continue;
+        changed = true;
+
+        switch (evt.type) {
+        case EVT_TRACK_STARTED:
+            failedInARow = 0;
+            if (evt.value > 0) trackDurationMs = evt.value;
+            savePlaybackState(true);
+            break;
+        case EVT_POSITION:
+        case EVT_RESUMED:
+            playbackTime = evt.value;
+            positionStampMs = millis();
+            savePlaybackState(false);
+            break;
+        case EVT_PAUSED:
+            playbackTime = evt.value;
+            positionStampMs = millis();
+            savePlaybackState(true);
+            break;
+        case EVT_TRACK_ENDED:
+            // Only a finished track gives up its resume position.
+            playbackTime = 0;
+            trackLoaded = false;
+            savePlaybackState(true);
+            if (currentUIState == UI_PLAYER && fileCount > 0) {
+                Serial.printf("Auto-advancing from track %lu\n", (unsigned long)currentFileIndex);
+                playPlayable(nextPlayable(currentFileIndex, 1));
+            }
+            break;
+        case EVT_STOPPED:
+            isPlaying = false;
+            isStoped = true;
+            trackLoaded = false;
+            break;
+        case EVT_TRACK_FAILED:
+            // The scan can't catch everything (a file changed since, a
+            // corrupt stream past the header), so keep going unless nothing
+            // in the folder plays at all.
+            if (currentUIState == UI_PLAYER && ++failedInARow < getPlayableCount()) {
+                Serial.printf("Track %lu failed, skipping\n", (unsigned long)currentFileIndex);
+                playPlayable(nextPlayable(currentFileIndex, 1));
+            } else {
+                failedInARow = 0;
+                isPlaying = false;
+                isStoped = true;
+                trackLoaded = false;
+            }
+            break;
+        }
+    }
+    return changed;
+}
+
+static uint32_t scrollStepFor(uint16_t repeat) {
+    if (repeat >= 40) return 20;
+    if (repeat >= 15) return 5;
+    return 1;
+}
+
+void handleKeyPress(char key, uint16_t repeat) {
     resetActivityTimer();
     
     if (key == 'c') {
@@ -403,6 +799,25 @@ void handleKeyPress(char key) {
         savedBrightness = M5Cardputer.Display.getBrightness() + brightnessStep;
         M5Cardputer.Display.setBrightness(savedBrightness);
         Serial.printf("Brightness: %d\n", savedBrightness);
+    } else if (key == 'i') {
+        profilerHudVisible = !profilerHudVisible;
+    } else if (key == 'o') {
+        profilerStreamEnabled = !profilerStreamEnabled;
+        Serial.printf("Profiler stream: %s\n", profilerStreamEnabled ? "on" : "off");
+    } else if (key == '[' || key == ']') {
+        int step = key == '[' ? -STRETCH_SPEED_STEP : STRETCH_SPEED_STEP;
+        playbackSpeed = constrain(playbackSpeed + step, STRETCH_SPEED_MIN, STRETCH_SPEED_MAX);
+        sendPlayerCommand(CMD_SPEED, playbackSpeed);
+        Serial.printf("Speed: %u%%\n", playbackSpeed);
+    } else if (key == INPUT_KEY_DIAGNOSTICS) {
+        // Cycles through the test signals and back to off; music stops.
+        diagSignal = (diagSignal + 1 < SIG_COUNT) ? diagSignal + 1 : -1;
+        sendPlayerCommand(CMD_DIAGNOSTICS, diagSignal);
+        isPlaying = false;
+        isStoped = true;
+        trackLoaded = false;
+        textPos = 90;
+        return;
     }
     if (currentUIState == UI_FOLDER_SELECT) {
         const bool hasParent = (currentFolder != "/");
@@ -418,88 +833,109 @@ void handleKeyPress(char key) {
             if (selectedFolderIndex >= totalItems) selectedFolderIndex = 0;
         } else if (key == '\n') {
             if (selectedFolderIndex == confirmButtonIndex) {
-                scanDirectory(currentFolder);
-                currentFileIndex = 0;
+                loadPlaylist(currentFolder);
                 currentUIState = UI_PLAYER;
-                selectedFileIndex = currentFileIndex;
-                if (selectedFileIndex >= fileCount) selectedFileIndex = 0;
-                if (fileCount <= VISIBLE_FILE_COUNT) {
-                    viewStartIndex = 0;
-                } else {
-                    viewStartIndex = max(0, (int)currentFileIndex - (VISIBLE_FILE_COUNT / 2));
-                }
-                isPlaying = true;
-                isStoped = false;
-                textPos = 90;
-                trackStartMillis = millis();
-                playbackTime = 0;
+                currentFileIndex = 0;
+                centerListOn(currentFileIndex);
+                if (fileCount > 0 && !isTrackPlayable(0)) playPlayable(nextPlayable(0, 1));
+                else playTrack(currentFileIndex);
             }
             else if (hasParent && selectedFolderIndex == 0) {
                 int lastSlash = currentFolder.lastIndexOf('/');
-                currentFolder = (lastSlash > 0) ? currentFolder.substring(0, lastSlash) : "/";
-                scanDirectory(currentFolder);
+                openDirectory((lastSlash > 0) ? currentFolder.substring(0, lastSlash) : "/");
                 selectedFolderIndex = 0;
             }
             else {
                 int folderIndex = selectedFolderIndex - baseParent;
                 if (folderIndex >= 0 && folderIndex < folderCount) {
-                    currentFolder = availableFolders[folderIndex];
-                    scanDirectory(currentFolder);
+                    openDirectory(availableFolders[folderIndex]);
                     selectedFolderIndex = 0;
                 }
             }
         } else if (key == '`' || key == '\b') {
             if (currentFolder != "/") {
                 int lastSlash = currentFolder.lastIndexOf('/');
-                currentFolder = (lastSlash > 0) ? currentFolder.substring(0, lastSlash) : "/";
-                scanDirectory(currentFolder);
+                openDirectory((lastSlash > 0) ? currentFolder.substring(0, lastSlash) : "/");
                 selectedFolderIndex = 0;
             }
         }
     } else {
         if (key == '`' || key == '\b') {
-            audio.stopSong();
-            trackStartMillis = millis();
+            if (fileCount > 0) savePlaybackState(true);
+            sendPlayerCommand(CMD_STOP);
+            diagSignal = -1;
             playbackTime = 0;
             isPlaying = false;
             isStoped = true;
+            trackLoaded = false;
             currentUIState = UI_FOLDER_SELECT;
             selectedFolderIndex = 0;
-            scanDirectory("/");
+            openDirectory("/");
         } else if (key == 'a' || key == ' ') {
             if (isPlaying && !isStoped) {
-                playbackTime = millis() - trackStartMillis;
+                sendPlayerCommand(CMD_PAUSE);
                 isPlaying = false;
                 isStoped = true;
-            } else {
-                trackStartMillis = millis() - playbackTime;
+            } else if (trackLoaded) {
+                sendPlayerCommand(CMD_RESUME);
                 isPlaying = true;
                 isStoped = false;
+            } else if (fileCount > 0) {
+                // Nothing left to resume (stopped, failed, or diagnostics).
+                playTrack(currentFileIndex, playbackTime);
+            }
+        } else if (key == 'b') {
+            if (fileCount > 0) saveBookmark(getTrackPath(currentFileIndex), playbackTime);
+        } else if (key == 'g') {
+            uint32_t positionMs;
+            if (fileCount > 0 && loadBookmark(getTrackPath(currentFileIndex), positionMs)) {
+                if (isStoped && !isPlaying) {
+                    playTrack(currentFileIndex, positionMs);
+                } else {
+                    sendPlayerCommand(CMD_SEEK, positionMs);
+                    playbackTime = positionMs;
+                    positionStampMs = millis();
+                }
+            }
+        } else if (key == '-' || key == '=') {
+            // Pick a seek target on the waveform, one bin per press; 's' jumps there.
+            if (fileCount > 0 && trackDurationMs > 0 && !isStoped) {
+                int16_t from = seekMarker >= 0 ? seekMarker : playedBin();
+                seekMarker = constrain(from + (key == '-' ? -1 : 1), 0, (int16_t)WAVEFORM_BINS - 1);
+            }
+        } else if (key == 's') {
+            if (seekMarker >= 0) {
+                uint32_t positionMs = (uint64_t)trackDurationMs * seekMarker / WAVEFORM_BINS;
+                seekMarker = -1;
+                if (isStoped && !isPlaying) {
+                    playTrack(currentFileIndex, positionMs);
+                } else {
+                    sendPlayerCommand(CMD_SEEK, positionMs);
+                    playbackTime = positionMs;
+                    positionStampMs = millis();
+                }
             }
         } else if (key == 'n' || key == '/' || key == 'p' || key == ',' || key == 'r' || key == '\n') {
             if (fileCount == 0) {
                 return;
             } else if (key == 'n' || key == '/') {
-                currentFileIndex = (currentFileIndex + 1) % fileCount;
+                playPlayable(nextPlayable(currentFileIndex, 1));
             } else if (key == 'p' || key == ',') {
-                currentFileIndex = (currentFileIndex == 0) ? (fileCount - 1) : (currentFileIndex - 1);
+                playPlayable(nextPlayable(currentFileIndex, -1));
             } else if (key == 'r') {
-                currentFileIndex = random(0, fileCount);
+                playPlayable(randomPlayable());
             } else if (key == '\n') {
-                if (selectedFileIndex < fileCount) currentFileIndex = selectedFileIndex;
+                playTrack(selectedFileIndex < fileCount ? selectedFileIndex : currentFileIndex);
             }
-            trackStartMillis = millis();
-            playbackTime = 0;
-            isPlaying = true;
-            isStoped = false;
-            textPos = 90;
-            nextTrackRequest = true;
         } else if (key == ';' || key == '.') {
             if (fileCount > 0) {
+                uint32_t step = scrollStepFor(repeat);
                 if (key == ';') {
-                    selectedFileIndex = (selectedFileIndex == 0) ? (fileCount - 1) : (selectedFileIndex - 1);
+                    if (selectedFileIndex >= step) selectedFileIndex -= step;
+                    else selectedFileIndex = (repeat == 0) ? (fileCount - 1) : 0;
                 } else {
-                    selectedFileIndex = (selectedFileIndex + 1) % fileCount;
+                    if (selectedFileIndex + step < fileCount) selectedFileIndex += step;
+                    else selectedFileIndex = (repeat == 0) ? 0 : (fileCount - 1);
                 }
 
                 if (fileCount <= VISIBLE_FILE_COUNT) {
@@ -0,0 +1,292 @@
+#include "waveform.h"
+#include "file_manager.h"
+#include "player_control.h"
+#include "frame_scheduler.h"
+#include "track_probe.h"
+#include <atomic>
+
+constexpr size_t PEAK_BYTES = WAVEFORM_BINS * 2;
+constexpr size_t WAV_SCAN_CHUNK = 4096;
+// Captured bins are sized from the estimated duration with room to spare,
+// then folded down to WAVEFORM_BINS once the real length is known.
+constexpr size_t CAPTURE_BINS = 512;
+constexpr size_t CAPTURE_TARGET_BINS = 400;
+
+struct WaveRequest {
+    uint32_t serial;
+    char path[PLAYER_PATH_MAX];
+};
+
+struct WaveStore {
+    char path[PLAYER_PATH_MAX];
+    int8_t peaks[PEAK_BYTES];
+};
+
+struct WaveFileHeader {
+    uint32_t magic;
+    uint16_t bins;
+    uint16_t reserved;
+};
+
+struct WaveCapture {
+    bool active;
+    uint32_t binFrames;
+    uint32_t framesSeen;
+    int16_t bins[CAPTURE_BINS][2];
+    char path[PLAYER_PATH_MAX];
+};
+
+static QueueHandle_t waveRequests = NULL;
+static QueueHandle_t waveStores = NULL;
+static TaskHandle_t waveTask = NULL;
+// The published envelope and the request it answers. Task_Wave fills it
+// and the UI copies it out, both under waveLock, so a draw never sees half
+// of one track and half of the next.
+static portMUX_TYPE waveLock = portMUX_INITIALIZER_UNLOCKED;
+static int8_t wavePeaks[PEAK_BYTES];
+static uint32_t waveSerial = 0;
+static bool waveReady = false;
+static std::atomic<uint32_t> requestSerial(0);
+static WaveRequest wanted = {0, ""};
+static int8_t scratch[PEAK_BYTES];
+static WaveCapture capture;
+
+static String cachePath(const char *path, uint32_t fileSize) {
+    uint32_t hash = 2166136261UL;
+    for (const char *p = path; *p; p++) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619UL;
+    }
+    char buf[48];
+    snprintf(buf, sizeof(buf), WAVEFORM_DIR "/%08lx-%lx.pks", (unsigned long)hash, (unsigned long)fileSize);
+    return String(buf);
+}
+
+static uint32_t fileSizeOf(const char *path) {
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File f = SD.open(path, FILE_READ);
+    uint32_t size = f ? f.size() : 0;
+    if (f) f.close();
+    xSemaphoreGive(sdMutex);
+    return size;
+}
+
+static bool writeCache(const String &cacheFile, const int8_t *peaks) {
+    WaveFileHeader header = {WAVEFORM_MAGIC, WAVEFORM_BINS, 0};
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File out = SD.open(cacheFile, FILE_WRITE);
+    bool ok = out && out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              out.write((const uint8_t *)peaks, PEAK_BYTES) == PEAK_BYTES;
+    if (out) out.close();
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+static bool loadCache(const String &cacheFile, int8_t *peaks) {
+    WaveFileHeader header;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File in = SD.open(cacheFile, FILE_READ);
+    bool ok = in && in.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == WAVEFORM_MAGIC && header.bins == WAVEFORM_BINS &&
+              in.read((uint8_t *)peaks, PEAK_BYTES) == PEAK_BYTES;
+    if (in) in.close();
+    xSemaphoreGive(sdMutex);
+    return ok;
+}
+
+static inline int16_t monoAt(const uint8_t *p, const TrackFormat &fmt) {
+    if (fmt.bitsPerSample == 8) {
+        int16_t l = (p[0] - 128) << 8;
+        return fmt.channels == 1 ? l : (l + ((p[1] - 128) << 8)) >> 1;
+    }
+    int16_t l = (int16_t)(p[0] | (p[1] << 8));
+    return fmt.channels == 1 ? l : (l + (int16_t)(p[2] | (p[3] << 8))) >> 1;
+}
+
+// PCM needs no decoder, so WAV files are read straight through, one chunk
+// per SD lock with a yield in between so playback's reads always get in.
+// Gives up as soon as a newer request arrives.
+static bool scanWav(const WaveRequest &req, int8_t *peaks) {
+    uint32_t serial = requestSerial;
+    TrackFormat fmt;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File f = SD.open(req.path, FILE_READ);
+    bool ok = f && probeTrackFile(f, String(req.path), fmt) && fmt.codec == CODEC_WAV;
+    uint32_t dataStart = ok ? f.position() : 0;
+    xSemaphoreGive(sdMutex);
+
+    static uint8_t chunk[WAV_SCAN_CHUNK];
+    uint32_t frameBytes = ok ? fmt.channels * (fmt.bitsPerSample / 8) : 1;
+    uint32_t totalFrames = ok ? (uint64_t)fmt.durationMs * fmt.sampleRate / 1000 : 0;
+    unsigned long start = millis();
+    for (size_t b = 0; ok && b < WAVEFORM_BINS; b++) {
+        uint32_t frame = (uint64_t)totalFrames * b / WAVEFORM_BINS;
+        uint32_t end = (uint64_t)totalFrames * (b + 1) / WAVEFORM_BINS;
+        int16_t lo = 0, hi = 0;
+        while (ok && frame < end) {
+            uint32_t frames = min(end - frame, (uint32_t)(sizeof(chunk) / frameBytes));
+            xSemaphoreTake(sdMutex, portMAX_DELAY);
+            ok = f.seek(dataStart + frame * frameBytes) && f.read(chunk, frames * frameBytes) == frames * frameBytes;
+            xSemaphoreGive(sdMutex);
+            for (uint32_t i = 0; ok && i < frames; i++) {
+                int16_t m = monoAt(chunk + i * frameBytes, fmt);
+                lo = min(lo, m);
+                hi = max(hi, m);
+            }
+            frame += frames;
+            vTaskDelay(1);
+            if (requestSerial != serial) ok = false;
+        }
+        peaks[2 * b] = lo >> 8;
+        peaks[2 * b + 1] = hi >> 8;
+    }
+
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    if (f) f.close();
+    xSemaphoreGive(sdMutex);
+    if (ok) Serial.printf("[Wave] Scanned %s in %lu ms\n", req.path, millis() - start);
+    return ok;
+}
+
+static void publish(uint32_t serial, const int8_t *peaks) {
+    portENTER_CRITICAL(&waveLock);
+    if (peaks) memcpy(wavePeaks, peaks, PEAK_BYTES);
+    waveSerial = serial;
+    waveReady = peaks != NULL;
+    portEXIT_CRITICAL(&waveLock);
+    requestRedraw(REDRAW_STATE);
+}
+
+static void handleRequest(const WaveRequest &req) {
+    wanted = req;
+    uint32_t fileSize = fileSizeOf(req.path);
+    if (fileSize == 0) {
+        publish(req.serial, NULL);
+        return;
+    }
+
+    String cacheFile = cachePath(req.path, fileSize);
+    if (loadCache(cacheFile, scratch)) {
+        publish(req.serial, scratch);
+        return;
+    }
+    publish(req.serial, NULL);
+    if (scanWav(req, scratch)) {
+        writeCache(cacheFile, scratch);
+        publish(req.serial, scratch);
+    }
+}
+
+static void handleStore(const WaveStore &store) {
+    uint32_t fileSize = fileSizeOf(store.path);
+    if (fileSize == 0 || !writeCache(cachePath(store.path, fileSize), store.peaks)) return;
+    Serial.printf("[Wave] Captured %s\n", store.path);
+    if (strcmp(store.path, wanted.path) == 0) publish(wanted.serial, store.peaks);
+}
+
+static void Task_Wave(void *) {
+    static WaveStore store;
+    WaveRequest req;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bool busy = true;
+        while (busy) {
+            busy = false;
+            if (xQueueReceive(waveStores, &store, 0) == pdTRUE) {
+                handleStore(store);
+                busy = true;
+            }
+            if (xQueueReceive(waveRequests, &req, 0) == pdTRUE) {
+                handleRequest(req);
+                busy = true;
+            }
+        }
+    }
+}
+
+void initWaveform() {
+    if (!SD.exists(WAVEFORM_DIR)) SD.mkdir(WAVEFORM_DIR);
+    waveRequests = xQueueCreate(1, sizeof(WaveRequest));
+    waveStores = xQueueCreate(1, sizeof(WaveStore));
+    // Same slot as the art task: lowest app priority on the UI core.
+    xTaskCreatePinnedToCore(Task_Wave, "Task_Wave", 6144, NULL, 1, &waveTask, 0);
+}
+
+uint32_t requestWaveform(const String &path) {
+    if (waveRequests == NULL) return 0;
+    WaveRequest req;
+    req.serial = ++requestSerial;
+    strlcpy(req.path, path.c_str(), sizeof(req.path));
+    xQueueOverwrite(waveRequests, &req);
+    xTaskNotifyGive(waveTask);
+    return req.serial;
+}
+
+bool waveformFor(uint32_t request, int8_t *peaks) {
+    portENTER_CRITICAL(&waveLock);
+    bool ok = waveReady && waveSerial == request;
+    if (ok) memcpy(peaks, wavePeaks, PEAK_BYTES);
+    portEXIT_CRITICAL(&waveLock);
+    return ok;
+}
+
+void waveformCaptureBegin(const char *path, uint32_t sampleRate, uint32_t durationMs) {
+    uint32_t frames = (uint64_t)durationMs * sampleRate / 1000;
+    capture.active = frames >= CAPTURE_TARGET_BINS;
+    if (!capture.active) return;
+    capture.binFrames = frames / CAPTURE_TARGET_BINS;
+    capture.framesSeen = 0;
+    memset(capture.bins, 0, sizeof(capture.bins));
+    strlcpy(capture.path, path, sizeof(capture.path));
+}
+
+void waveformCaptureFrames(const int16_t *frames, size_t frameCount) {
+    while (capture.active && frameCount > 0) {
+        uint32_t bin = capture.framesSeen / capture.binFrames;
+        if (bin >= CAPTURE_BINS) {
+            // The duration estimate was far off; a wrong envelope is worse than none.
+            capture.active = false;
+            return;
+        }
+        size_t run = min(frameCount, (size_t)(capture.binFrames - capture.framesSeen % capture.binFrames));
+        int16_t lo = capture.bins[bin][0], hi = capture.bins[bin][1];
+        for (size_t i = 0; i < run; i++) {
+            int16_t m = (frames[2 * i] + frames[2 * i + 1]) >> 1;
+            lo = min(lo, m);
+            hi = max(hi, m);
+        }
+        capture.bins[bin][0] = lo;
+        capture.bins[bin][1] = hi;
+        frames += 2 * run;
+        frameCount -= run;
+        capture.framesSeen += run;
+    }
+}
+
+void waveformCaptureAbort() {
+    capture.active = false;
+}
+
+void waveformCaptureEnd() {
+    if (!capture.active) return;
+    capture.active = false;
+    uint32_t used = (capture.framesSeen + capture.binFrames - 1) / capture.binFrames;
+    // A decode that died early would leave a truncated envelope.
+    if (used < CAPTURE_TARGET_BINS / 2 || waveStores == NULL) return;
+
+    static WaveStore store;
+    strlcpy(store.path, capture.path, sizeof(store.path));
+    for (size_t b = 0; b < WAVEFORM_BINS; b++) {
+        size_t from = used * b / WAVEFORM_BINS;
+        size_t to = max(from + 1, used * (b + 1) / WAVEFORM_BINS);
+        int16_t lo = 0, hi = 0;
+        for (size_t i = from; i < to; i++) {
+            lo = min(lo, capture.bins[i][0]);
+            hi = max(hi, capture.bins[i][1]);
+        }
+        store.peaks[2 * b] = lo >> 8;
+        store.peaks[2 * b + 1] = hi >> 8;
+    }
+    xQueueOverwrite(waveStores, &store);
+    xTaskNotifyGive(waveTask);
+}
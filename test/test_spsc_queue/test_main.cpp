@@ -0,0 +1,94 @@
+// Host stress test for the UI <-> audio queues: one thread per side, as on
+// the device, pushing sequence-numbered items through queues of the same
+// types and capacities as playerCommands/playerEvents.
+//   pio test -e native
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include "player_control.h"
+
+constexpr uint32_t STRESS_ITEMS = 1000000;
+
+void setUp() {}
+void tearDown() {}
+
+static void test_commands_arrive_in_order_without_loss() {
+    static SpscQueue<PlayerCommand, 8> queue;
+    std::thread producer([] {
+        PlayerCommand cmd = {};
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+            cmd.type = (PlayerCommandType)(i % (CMD_SPEED + 1));
+            cmd.trackIndex = i;
+            cmd.value = (int32_t)~i;
+            snprintf(cmd.path, sizeof(cmd.path), "/music/%lu.mp3", (unsigned long)i);
+            while (!queue.push(cmd)) std::this_thread::yield();
+        }
+    });
+
+    PlayerCommand cmd;
+    char expectedPath[PLAYER_PATH_MAX];
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+        while (!queue.pop(cmd)) std::this_thread::yield();
+        snprintf(expectedPath, sizeof(expectedPath), "/music/%lu.mp3", (unsigned long)i);
+        // Sequence, a second field and the path together catch reordering,
+        // drops, duplicates and torn copies.
+        if (cmd.trackIndex != i || cmd.value != (int32_t)~i || strcmp(cmd.path, expectedPath) != 0) mismatches++;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_FALSE(queue.pop(cmd));
+}
+
+static void test_events_arrive_in_order_without_loss() {
+    static SpscQueue<PlayerEvent, 32> queue;
+    std::thread producer([] {
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+            PlayerEvent evt = {(PlayerEventType)(i % (EVT_STOPPED + 1)), i, i * 3, i / 7};
+            while (!queue.push(evt)) std::this_thread::yield();
+        }
+    });
+
+    PlayerEvent evt;
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+        while (!queue.pop(evt)) std::this_thread::yield();
+        if (evt.trackIndex != i || evt.value != i * 3 || evt.generation != i / 7 ||
+            evt.type != (PlayerEventType)(i % (EVT_STOPPED + 1))) {
+            mismatches++;
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+static void test_full_queue_rejects_without_overwriting() {
+    SpscQueue<PlayerEvent, 32> queue;
+    for (uint32_t i = 0; i < 32; i++) {
+        PlayerEvent evt = {EVT_POSITION, i, 0, 0};
+        TEST_ASSERT_TRUE(queue.push(evt));
+    }
+    PlayerEvent extra = {EVT_STOPPED, 99, 0, 0};
+    TEST_ASSERT_FALSE(queue.push(extra));
+    TEST_ASSERT_EQUAL_UINT32(32, queue.size());
+
+    PlayerEvent evt;
+    for (uint32_t i = 0; i < 32; i++) {
+        TEST_ASSERT_TRUE(queue.pop(evt));
+        TEST_ASSERT_EQUAL_UINT32(i, evt.trackIndex);
+    }
+    TEST_ASSERT_FALSE(queue.pop(evt));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_queue_rejects_without_overwriting);
+    RUN_TEST(test_commands_arrive_in_order_without_loss);
+    RUN_TEST(test_events_arrive_in_order_without_loss);
+    return UNITY_END();
+}
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Generate the decoder benchmark corpus.
+
+Writes a deterministic test signal (a chord with harmonics, stereo detune
+and noise bursts, so the encoder has real work to do) and encodes it into
+the formats listed in CORPUS. Copy the output folder to /bench on the SD
+card and send "bench" on the serial console, or pass the parent folder as
+the SD root to the native benchmark.
+
+    tools/make_bench_corpus.py [outdir] [--seconds N]
+
+MP3 files need `lame` (preferred) or `ffmpeg` with libmp3lame on PATH,
+FLAC files `flac` or `ffmpeg`; entries without an encoder are skipped.
+The 24-bit/96 kHz FLAC is there to measure a stream the default cost
+model refuses.
+"""
+
+import argparse
+import array
+import math
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+import wave
+
+# name, sample rate, channels, bits, encoder args (lame or flac), ffmpeg args
+CORPUS = [
+    ("wav_44k1_s16_stereo.wav", 44100, 2, 16, None, None),
+    ("wav_48k_s16_stereo.wav", 48000, 2, 16, None, None),
+    ("mp3_064k_cbr_22k05_mono.mp3", 22050, 1, 16, ["-b", "64", "--cbr", "-m", "m"], ["-b:a", "64k"]),
+    ("mp3_128k_cbr_44k1_stereo.mp3", 44100, 2, 16, ["-b", "128", "--cbr", "-m", "s"], ["-b:a", "128k", "-joint_stereo", "0"]),
+    ("mp3_128k_cbr_44k1_joint.mp3", 44100, 2, 16, ["-b", "128", "--cbr", "-m", "j"], ["-b:a", "128k", "-joint_stereo", "1"]),
+    ("mp3_192k_cbr_48k_joint.mp3", 48000, 2, 16, ["-b", "192", "--cbr", "-m", "j"], ["-b:a", "192k", "-joint_stereo", "1"]),
+    ("mp3_320k_cbr_44k1_joint.mp3", 44100, 2, 16, ["-b", "320", "--cbr", "-m", "j"], ["-b:a", "320k", "-joint_stereo", "1"]),
+    ("mp3_v0_vbr_44k1_joint.mp3", 44100, 2, 16, ["-V", "0", "-m", "j"], ["-q:a", "0", "-joint_stereo", "1"]),
+    ("mp3_v6_vbr_44k1_joint.mp3", 44100, 2, 16, ["-V", "6", "-m", "j"], ["-q:a", "6", "-joint_stereo", "1"]),
+    ("flac_l5_44k1_s16_stereo.flac", 44100, 2, 16, ["-5"], ["-compression_level", "5"]),
+    ("flac_l8_48k_s16_stereo.flac", 48000, 2, 16, ["-8"], ["-compression_level", "8"]),
+    ("flac_l5_48k_s24_stereo.flac", 48000, 2, 24, ["-5"], ["-compression_level", "5"]),
+    ("flac_l5_96k_s24_stereo.flac", 96000, 2, 24, ["-5"], ["-compression_level", "5"]),
+]
+
+CHORD_HZ = (220.0, 277.18, 329.63, 440.0)
+
+
+def render(rate, channels, bits, seconds):
+    rng = random.Random(rate * 10 + channels)
+    full = (1 << (bits - 1)) - 1
+    samples = array.array("i")
+    burst = 0
+    for n in range(rate * seconds):
+        t = n / rate
+        if n % (rate // 4) == 0:
+            burst = rate // 40
+        env = 0.6 + 0.4 * math.sin(2 * math.pi * 0.5 * t)
+        frame = []
+        for ch in range(channels):
+            detune = 1.0 + 0.002 * ch
+            v = 0.0
+            for i, f in enumerate(CHORD_HZ):
+                w = 2 * math.pi * f * detune * t
+                v += (math.sin(w) + 0.3 * math.sin(2 * w) + 0.15 * math.sin(3 * w)) / (i + 1)
+            v *= 0.25 * env
+            if burst:
+                v += 0.3 * (rng.random() * 2 - 1) * burst / (rate // 40)
+            frame.append(max(-full, min(full, int(v * full))))
+        if burst:
+            burst -= 1
+        samples.extend(frame)
+    return samples
+
+
+def write_wav(path, rate, channels, bits, samples):
+    width = bits // 8
+    with wave.open(path, "wb") as w:
+        w.setnchannels(channels)
+        w.setsampwidth(width)
+        w.setframerate(rate)
+        w.writeframes(b"".join(s.to_bytes(width, "little", signed=True) for s in samples))
+
+
+def encode(src, dst, args, ffmpeg_args):
+    flac = dst.endswith(".flac")
+    if flac and shutil.which("flac"):
+        cmd = ["flac", "--silent", "--force"] + args + ["-o", dst, src]
+    elif not flac and shutil.which("lame"):
+        cmd = ["lame", "--quiet", "--noreplaygain"] + args + [src, dst]
+    elif shutil.which("ffmpeg"):
+        codec = "flac" if flac else "libmp3lame"
+        cmd = ["ffmpeg", "-loglevel", "error", "-y", "-i", src, "-codec:a", codec] + ffmpeg_args + [dst]
+    else:
+        return False
+    subprocess.run(cmd, check=True)
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("outdir", nargs="?", default="bench")
+    parser.add_argument("--seconds", type=int, default=30)
+    args = parser.parse_args()
+
+    os.makedirs(args.outdir, exist_ok=True)
+    rendered = {}
+    with tempfile.TemporaryDirectory() as tmp:
+        for name, rate, channels, bits, enc_args, ffmpeg_args in CORPUS:
+            key = (rate, channels, bits)
+            if key not in rendered:
+                pcm = os.path.join(tmp, "src_%d_%d_%d.wav" % key)
+                write_wav(pcm, rate, channels, bits, render(rate, channels, bits, args.seconds))
+                rendered[key] = pcm
+
+            dst = os.path.join(args.outdir, name)
+            if enc_args is None:
+                shutil.copyfile(rendered[key], dst)
+            elif not encode(rendered[key], dst, enc_args, ffmpeg_args):
+                print("skip %s: no encoder on PATH" % name)
+                continue
+            print("wrote %s (%d bytes)" % (dst, os.path.getsize(dst)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,316 @@
+#!/usr/bin/env python3
+"""Host driver for the player's framed serial remote protocol.
+
+Talks to the Cardputer over USB CDC (/dev/ttyACM0) or to the native build
+started with `program --serve`, which prints the pty to use. Frames are
+picked out of the log stream; log text is printed with --log.
+
+    tools/remote.py PORT state
+    tools/remote.py PORT counters
+    tools/remote.py PORT key n
+    tools/remote.py PORT open /music [--track N]
+    tools/remote.py PORT play N | next | prev | pause | stop
+    tools/remote.py PORT seek MS | volume V | scan /folder
+    tools/remote.py PORT ping [--count N]
+    tools/remote.py PORT skip-storm [--count N] [--interval MS]
+    tools/remote.py PORT scan-stress [--folders /a,/b] [--count N]
+    tools/remote.py PORT soak [--duration S] [--period S]
+
+Stress runs print the round-trip latency distribution of the commands
+they sent plus the device-side counter deltas (underruns, key-to-audio
+latency) over the run.
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import threading
+import time
+
+STX = 0x02
+REPLY = 0x80
+ERROR = 0xFF
+
+PING, KEY, ACTION, GET_STATE, GET_COUNTERS = 0x01, 0x02, 0x03, 0x04, 0x05
+
+ACT_PLAY, ACT_NEXT, ACT_PREV, ACT_TOGGLE_PAUSE, ACT_STOP, ACT_SEEK, ACT_VOLUME, ACT_OPEN_FOLDER, ACT_SCAN = range(1, 10)
+
+STATUS = {0: "ok", 1: "bad frame", 2: "unknown", 3: "rejected"}
+
+# Order matches sendCounters() in src/remote_control.cpp.
+COUNTERS = [
+    "uptime_ms", "fps_x10", "render_us", "push_us", "cpu_ui", "cpu_audio",
+    "audio_period_max_us", "decoder_underruns", "heap_free", "heap_largest",
+    "key_audio_last_us", "key_audio_avg_us", "key_audio_max_us", "key_audio_samples",
+    "key_pixels_last_us", "key_pixels_avg_us", "key_pixels_max_us", "key_pixels_samples",
+    "output_underruns", "dma_reconfigs", "dma_count", "output_latency_us",
+    "dir_cache_hits", "dir_cache_misses", "frames_total", "frame_max_us",
+    "skip_audio_last_us", "skip_audio_avg_us", "skip_audio_max_us", "skip_audio_samples",
+    "playable_tracks",
+]
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+class RemoteError(Exception):
+    pass
+
+
+class Remote:
+    def __init__(self, port, log=False):
+        self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+        attrs = termios.tcgetattr(self.fd)
+        attrs[0] = attrs[1] = attrs[3] = 0
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[4] = attrs[5] = termios.B115200
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.log = log
+        self.seq = 0
+        self.replies = {}
+        self.cond = threading.Condition()
+        self.running = True
+        self.reader = threading.Thread(target=self._read_loop, daemon=True)
+        self.reader.start()
+
+    def close(self):
+        self.running = False
+        os.close(self.fd)
+
+    def _read_loop(self):
+        buf = bytearray()
+        text = bytearray()
+        while self.running:
+            ready, _, _ = select.select([self.fd], [], [], 0.1)
+            if not ready:
+                continue
+            try:
+                buf += os.read(self.fd, 4096)
+            except OSError:
+                return
+            while buf:
+                if buf[0] != STX:
+                    end = buf.find(STX)
+                    end = len(buf) if end < 0 else end
+                    text += buf[:end]
+                    del buf[:end]
+                    self._emit_text(text)
+                    continue
+                if len(buf) < 4 or len(buf) < buf[1] + 6:
+                    break
+                n = buf[1]
+                body = bytes(buf[1:4 + n])
+                crc = buf[4 + n] | (buf[5 + n] << 8)
+                if crc != crc16(body):
+                    del buf[:1]  # a stray STX; resync on the next one
+                    continue
+                seq, mtype, payload = buf[2], buf[3], bytes(buf[4:4 + n])
+                del buf[:6 + n]
+                with self.cond:
+                    self.replies[seq] = (mtype, payload, time.monotonic())
+                    self.cond.notify_all()
+
+    def _emit_text(self, text):
+        while b"\n" in text:
+            line, _, rest = bytes(text).partition(b"\n")
+            text[:] = rest
+            if self.log:
+                sys.stderr.write("| " + line.decode("utf-8", "replace").rstrip("\r") + "\n")
+
+    def request(self, mtype, payload=b"", timeout=2.0):
+        self.seq = (self.seq + 1) & 0xFF
+        seq = self.seq
+        body = bytes([len(payload), seq, mtype]) + payload
+        frame = bytes([STX]) + body + struct.pack("<H", crc16(body))
+        with self.cond:
+            self.replies.pop(seq, None)
+        start = time.monotonic()
+        os.write(self.fd, frame)
+        deadline = start + timeout
+        with self.cond:
+            while seq not in self.replies:
+                left = deadline - time.monotonic()
+                if left <= 0:
+                    raise RemoteError("timeout waiting for reply to 0x%02x" % mtype)
+                self.cond.wait(left)
+            rtype, rpayload, at = self.replies.pop(seq)
+        if rtype == ERROR:
+            raise RemoteError("device error: %s" % STATUS.get(rpayload[0], rpayload[0]))
+        if rtype != mtype | REPLY:
+            raise RemoteError("unexpected reply type 0x%02x" % rtype)
+        return rpayload, (at - start) * 1e6
+
+    def ping(self, data=b"ping"):
+        return self.request(PING, data)[1]
+
+    def key(self, ch, repeat=0):
+        payload, rtt = self.request(KEY, struct.pack("<BH", ord(ch), repeat))
+        return payload[0] == 0, rtt
+
+    def action(self, act, value=0, path=""):
+        raw = path.encode()
+        payload, rtt = self.request(ACTION, struct.pack("<BiB", act, value, len(raw)) + raw)
+        return payload[0] == 0, rtt
+
+    def state(self):
+        p, _ = self.request(GET_STATE)
+        ui, flags, count, index, pos, dur, vol, bright, uptime = struct.unpack_from("<BBIIIIbBI", p)
+        off = struct.calcsize("<BBIIIIbBI")
+        folder, off = _string(p, off)
+        track, off = _string(p, off)
+        return {
+            "ui": "player" if ui == 1 else "folders",
+            "playing": bool(flags & 1), "stopped": bool(flags & 2), "dimmed": bool(flags & 4),
+            "files": count, "index": index, "position_ms": pos, "duration_ms": dur,
+            "volume": vol, "brightness": bright, "uptime_ms": uptime,
+            "folder": folder, "track": track,
+        }
+
+    def counters(self):
+        p, _ = self.request(GET_COUNTERS)
+        values = struct.unpack_from("<%dI" % p[0], p, 1)
+        names = COUNTERS + ["c%d" % i for i in range(len(COUNTERS), len(values))]
+        return dict(zip(names, values))
+
+
+def _string(p, off):
+    n = p[off]
+    return p[off + 1:off + 1 + n].decode("utf-8", "replace"), off + 1 + n
+
+
+def percentiles(samples):
+    if not samples:
+        return "no samples"
+    s = sorted(samples)
+    pick = lambda q: s[min(len(s) - 1, int(q * len(s)))]
+    return "n=%d min=%.0f p50=%.0f p90=%.0f p99=%.0f max=%.0f us" % (
+        len(s), s[0], pick(0.5), pick(0.9), pick(0.99), s[-1])
+
+
+def report(remote, before, rtts, label):
+    after = remote.counters()
+    print("%s round trip: %s" % (label, percentiles(rtts)))
+    for name in ("output_underruns", "decoder_underruns", "dma_reconfigs", "dir_cache_misses"):
+        print("  %-20s +%d" % (name, after[name] - before[name]))
+    for name in ("key_audio_avg_us", "key_audio_max_us", "key_pixels_avg_us", "key_pixels_max_us",
+                 "frame_max_us", "heap_free"):
+        print("  %-20s %d" % (name, after[name]))
+
+
+def skip_storm(remote, count, interval_ms):
+    before = remote.counters()
+    rtts = []
+    for i in range(count):
+        ok, rtt = remote.action(ACT_NEXT if i % 4 else ACT_PREV)
+        if ok:
+            rtts.append(rtt)
+        time.sleep(interval_ms / 1000.0)
+    time.sleep(1.0)
+    report(remote, before, rtts, "skip")
+    print(remote.state())
+
+
+def scan_stress(remote, folders, count):
+    before = remote.counters()
+    rtts = []
+    for i in range(count):
+        ok, rtt = remote.action(ACT_SCAN, 0, folders[i % len(folders)])
+        if ok:
+            rtts.append(rtt)
+        if i % 8 == 7:
+            remote.action(ACT_NEXT)
+    time.sleep(1.0)
+    report(remote, before, rtts, "scan")
+
+
+def soak(remote, duration, period, stall_s=3.0):
+    """Polls state and flags any stretch of stall_s seconds where a playing
+    track's position (1 s granularity) doesn't move."""
+    before = remote.counters()
+    rtts = []
+    stalls = 0
+    moved_at, last = time.monotonic(), None
+    end = time.monotonic() + duration
+    while time.monotonic() < end:
+        t0 = time.monotonic()
+        st = remote.state()
+        now = time.monotonic()
+        rtts.append((now - t0) * 1e6)
+        if last is None or not st["playing"] or st["index"] != last["index"] or st["position_ms"] != last["position_ms"]:
+            moved_at = now
+        elif now - moved_at > stall_s:
+            stalls += 1
+            moved_at = now
+            print("stall at track %d %d ms" % (st["index"], st["position_ms"]))
+        last = st
+        time.sleep(period)
+    report(remote, before, rtts, "state")
+    print("  %-20s %d" % ("position_stalls", stalls))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Cardputer player remote control")
+    ap.add_argument("port")
+    ap.add_argument("command")
+    ap.add_argument("args", nargs="*")
+    ap.add_argument("--log", action="store_true", help="echo the device log to stderr")
+    ap.add_argument("--count", type=int, default=100)
+    ap.add_argument("--interval", type=float, default=50, help="ms between skip-storm commands")
+    ap.add_argument("--track", type=int, default=0)
+    ap.add_argument("--folders", default="/")
+    ap.add_argument("--duration", type=float, default=600)
+    ap.add_argument("--period", type=float, default=1.0)
+    opts = ap.parse_args()
+
+    remote = Remote(opts.port, log=opts.log)
+    cmd, args = opts.command, opts.args
+    simple = {"next": ACT_NEXT, "prev": ACT_PREV, "pause": ACT_TOGGLE_PAUSE, "stop": ACT_STOP}
+    valued = {"play": ACT_PLAY, "seek": ACT_SEEK, "volume": ACT_VOLUME}
+    try:
+        if cmd == "state":
+            for k, v in remote.state().items():
+                print("%-12s %s" % (k, v))
+        elif cmd == "counters":
+            for k, v in remote.counters().items():
+                print("%-20s %d" % (k, v))
+        elif cmd == "ping":
+            print(percentiles([remote.ping() for _ in range(opts.count)]))
+        elif cmd == "key":
+            for ch in "".join(args).replace("\\n", "\n"):
+                print(remote.key(ch)[0])
+        elif cmd in simple:
+            print(STATUS[0] if remote.action(simple[cmd])[0] else STATUS[3])
+        elif cmd in valued:
+            print(STATUS[0] if remote.action(valued[cmd], int(args[0]))[0] else STATUS[3])
+        elif cmd == "open":
+            print(STATUS[0] if remote.action(ACT_OPEN_FOLDER, opts.track, args[0])[0] else STATUS[3])
+        elif cmd == "scan":
+            print(STATUS[0] if remote.action(ACT_SCAN, 0, args[0])[0] else STATUS[3])
+        elif cmd == "skip-storm":
+            skip_storm(remote, opts.count, opts.interval)
+        elif cmd == "scan-stress":
+            scan_stress(remote, opts.folders.split(","), opts.count)
+        elif cmd == "soak":
+            soak(remote, opts.duration, opts.period)
+        else:
+            ap.error("unknown command %s" % cmd)
+    except RemoteError as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    finally:
+        remote.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())